@@ -0,0 +1,147 @@
+#include "Bench.h"
+#include "AllocationCounter.h"
+#include "CpuFeatures.h"
+#include "Fft.h"
+#include "Spectrogram.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <type_traits>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Timing {
+    double ns;
+    size_t allocations;
+};
+
+Timing timeOps(const std::function<void()> &op, size_t iterations) {
+    size_t allocationsBefore = totalAllocations();
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; i++) op();
+    auto stop = Clock::now();
+    return {std::chrono::duration<double, std::nano>(stop - start).count(), totalAllocations() - allocationsBefore};
+}
+
+std::string escapeJson(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out;
+}
+
+// JSON has no infinity or NaN
+double jsonNumber(double v) {
+    return std::isfinite(v) ? v : 0.0;
+}
+
+} // namespace
+
+bool BenchRunner::enabled(const std::string &name) const {
+    return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+}
+
+BenchResult *BenchRunner::run(const std::string &name, double itemsPerOp, const std::string &itemName,
+                              const std::function<void()> &op) {
+    if (!enabled(name)) return nullptr;
+
+    // Warm up (caches, lazily built tables, first touch of buffers), then grow the iteration count until one run
+    // lasts minSeconds
+    op();
+    size_t iterations = 1;
+    double minNs = opts.minSeconds * 1e9;
+    Timing timing = timeOps(op, iterations);
+    while (timing.ns < minNs) {
+        double scale = timing.ns > 0 ? 1.4 * minNs / timing.ns : 10.0;
+        iterations = std::max(iterations + 1, size_t(double(iterations) * std::min(scale, 10.0)));
+        timing = timeOps(op, iterations);
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerOp = timing.ns / iterations;
+    result.allocationsPerOp = double(timing.allocations) / iterations;
+    for (size_t r = 1; r < opts.repetitions; r++) {
+        Timing again = timeOps(op, iterations);
+        result.nsPerOp = std::min(result.nsPerOp, again.ns / iterations);
+    }
+    result.itemsPerOp = itemsPerOp;
+    result.itemName = itemName;
+    return finish(std::move(result));
+}
+
+BenchResult *BenchRunner::runOnce(const std::string &name, size_t ops, double itemsPerOp,
+                                  const std::string &itemName, const std::function<void()> &op) {
+    if (!enabled(name)) return nullptr;
+
+    ops = std::max<size_t>(ops, 1);
+    Timing timing = timeOps(op, 1);
+    BenchResult result;
+    result.name = name;
+    result.iterations = ops;
+    result.nsPerOp = timing.ns / ops;
+    result.allocationsPerOp = double(timing.allocations) / ops;
+    result.itemsPerOp = itemsPerOp;
+    result.itemName = itemName;
+    return finish(std::move(result));
+}
+
+BenchResult *BenchRunner::finish(BenchResult result) {
+    std::cerr << std::left << std::setw(44) << result.name << std::right << std::setw(14) << std::fixed
+              << std::setprecision(1) << result.nsPerOp << " ns/op";
+    if (result.itemsPerOp > 0) {
+        std::cerr << std::setw(12) << std::setprecision(2) << result.itemsPerSecond() / 1e6 << " M"
+                  << result.itemName << "/s";
+    }
+    std::cerr << std::setw(10) << std::setprecision(1) << result.allocationsPerOp << " allocs/op\n";
+    std::cerr.unsetf(std::ios::floatfield);
+
+    all.push_back(std::move(result));
+    return &all.back();
+}
+
+void BenchRunner::writeJson(std::ostream &out) const {
+    out << std::setprecision(10);
+    out << "{\n  \"context\": {\n";
+    out << "    \"simd\": \"" << simdLevelName(simdLevel()) << "\",\n";
+    out << "    \"sample_type\": \"" << (std::is_same<sample_t, float>::value ? "float" : "double") << "\",\n";
+    out << "    \"frame_size\": " << FRAME_SIZE << ",\n";
+    out << "    \"hop_size\": " << HOP_SIZE << ",\n";
+    out << "    \"threads\": " << opts.threads << ",\n";
+    out << "    \"quick\": " << (opts.quick ? "true" : "false") << ",\n";
+    out << "    \"allocation_counting\": " << (allocationCountingEnabled() ? "true" : "false") << ",\n";
+#if defined(NDEBUG)
+    out << "    \"assertions\": false\n";
+#else
+    out << "    \"assertions\": true\n";
+#endif
+    out << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < all.size(); i++) {
+        const BenchResult &r = all[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << escapeJson(r.name) << "\", \"iterations\": "
+            << r.iterations << ", \"ns_per_op\": " << jsonNumber(r.nsPerOp);
+        if (r.itemsPerOp > 0) {
+            out << ", \"items_per_op\": " << r.itemsPerOp << ", \"item\": \"" << escapeJson(r.itemName)
+                << "\", \"" << escapeJson(r.itemName) << "_per_second\": " << jsonNumber(r.itemsPerSecond());
+        }
+        out << ", \"allocations_per_op\": " << r.allocationsPerOp;
+        if (!r.metrics.empty()) {
+            out << ", \"metrics\": {";
+            for (size_t m = 0; m < r.metrics.size(); m++) {
+                out << (m ? ", " : "") << "\"" << escapeJson(r.metrics[m].first) << "\": "
+                    << jsonNumber(r.metrics[m].second);
+            }
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
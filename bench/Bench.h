@@ -0,0 +1,90 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define BENCH_MIN_SECONDS 0.25 // Time each timed run of a microbenchmark lasts at least
+#define BENCH_REPETITIONS 3 // Timed runs per microbenchmark; the fastest is reported
+
+// What a benchmark measured. Everything is per op, where an op is one call of the benchmarked code.
+struct BenchResult {
+    std::string name; // Slash separated, e.g. "fft/plan/1024"
+    size_t iterations = 0; // Ops in the reported run
+    double nsPerOp = 0.0;
+    double itemsPerOp = 0.0; // Units of work per op (samples, frames, hashes, ...); 0 for none
+    std::string itemName; // What the items are, e.g. "samples"
+    double allocationsPerOp = 0.0; // Heap allocations (from every thread) per op
+    std::vector<std::pair<std::string, double>> metrics; // Benchmark specific results, e.g. accuracy
+
+    double itemsPerSecond() const { return nsPerOp > 0 ? itemsPerOp * 1e9 / nsPerOp : 0.0; }
+};
+
+struct BenchOptions {
+    std::string filter; // Only run benchmarks whose name contains this (empty for all)
+    double minSeconds = BENCH_MIN_SECONDS;
+    size_t repetitions = BENCH_REPETITIONS;
+    size_t threads = 1; // Threads for the stages that can use more than one
+    bool quick = false; // Smaller inputs and catalogs, for smoke testing the suite
+};
+
+/**
+ * Runs benchmarks and collects their results. A microbenchmark repeats an op until a run lasts at least
+ * minSeconds and reports the fastest of several runs, which filters out interference from the rest of the
+ * machine; a macrobenchmark runs its (expensive) op exactly once. Both count the heap allocations made while the
+ * op runs (see AllocationCounter.h), so allocations creeping into a hot loop show up in the results.
+ */
+class BenchRunner {
+public:
+    explicit BenchRunner(BenchOptions options) : opts(std::move(options)) {}
+
+    const BenchOptions &options() const { return opts; }
+    bool enabled(const std::string &name) const;
+
+    /**
+     * Time a microbenchmark.
+     *
+     * @param name The benchmark's name.
+     * @param itemsPerOp Units of work in one op, for the throughput (0 for none).
+     * @param itemName What the units are.
+     * @param op The code to time; its result must be consumed (e.g. with doNotOptimize).
+     * @return The result, which the caller may add metrics to, or nullptr if the benchmark is filtered out.
+     */
+    BenchResult *run(const std::string &name, double itemsPerOp, const std::string &itemName,
+                     const std::function<void()> &op);
+
+    /**
+     * Time a macrobenchmark: op runs once, performing ops operations (e.g. one per query), and is reported per
+     * operation. See run for the other parameters.
+     */
+    BenchResult *runOnce(const std::string &name, size_t ops, double itemsPerOp, const std::string &itemName,
+                         const std::function<void()> &op);
+
+    const std::deque<BenchResult> &results() const { return all; }
+
+    // Write every result, plus the configuration they were measured in, as one JSON document
+    void writeJson(std::ostream &out) const;
+
+private:
+    BenchOptions opts;
+    std::deque<BenchResult> all; // A deque, so results handed out stay put as more are added
+
+    BenchResult *finish(BenchResult result);
+};
+
+// Keep the compiler from optimizing away a value that is otherwise unused
+template <typename T>
+inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+// Benchmark suites (MicroBenchmarks.cpp and MacroBenchmarks.cpp)
+void runMicroBenchmarks(BenchRunner &runner);
+void runMacroBenchmarks(BenchRunner &runner);
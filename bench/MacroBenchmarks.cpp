@@ -0,0 +1,178 @@
+// Macrobenchmarks: the whole pipeline end to end over a synthetic catalog generated in process, the way ingest
+// and recognition run it (streaming STFT into the peak extractor, fingerprints into the index and matcher)
+#include "Bench.h"
+#include "Fingerprint.h"
+#include "FingerprintIndex.h"
+#include "Matcher.h"
+#include "Peaks.h"
+#include "StreamingStft.h"
+#include "Synthetic.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+
+#define MACRO_CATALOG_SONGS 10 // Songs in the synthetic catalog
+#define MACRO_SONG_SECONDS 60.0
+#define MACRO_QUERIES 40 // Recognition queries, each an excerpt of a random catalog song
+#define MACRO_QUERY_SECONDS 8.0
+#define MACRO_QUERY_SNR_DB 10.0 // Noise added to every query
+#define MACRO_FRAME_TOLERANCE 2 // Frames a matched offset may be off by and still count as correct
+
+namespace {
+
+struct Query {
+    uint32_t songId;
+    size_t start; // First sample of the excerpt within the song
+    std::vector<float> clip;
+};
+
+// Fingerprint a signal the way ingest does, block by block through a StreamingStft
+template <typename Real>
+void fingerprintSignal(const std::vector<float> &signal, std::vector<fingerprint> &out) {
+    PeakExtractor extractor(FRAME_SIZE / 2 + 1);
+    StreamingStft<Real> stft(SYNTHETIC_SAMPLE_RATE,
+                             [&](size_t, const std::complex<Real> *bins) { extractor.push(bins); });
+    for (size_t i = 0; i < signal.size(); i += 4096) {
+        stft.push(signal.data() + i, std::min<size_t>(4096, signal.size() - i));
+    }
+    stft.flush();
+    extractor.flush();
+    generateFingerprints(extractor.takePeaks(), out);
+}
+
+// Fingerprint every song (a song per task) and index them; each song's fingerprints are kept in songPrints
+template <typename Real>
+FingerprintIndex buildCatalog(const std::vector<std::vector<float>> &songs, ThreadPool *pool,
+                              std::vector<std::vector<fingerprint>> &songPrints) {
+    songPrints.assign(songs.size(), {});
+    size_t workers = pool ? pool->numOfWorkers() : 1;
+    std::vector<FingerprintIndexBuilder> builders(workers);
+    auto task = [&](size_t s, size_t worker) {
+        fingerprintSignal<Real>(songs[s], songPrints[s]);
+        builders[worker].add(uint32_t(s), songPrints[s]);
+    };
+    if (pool) {
+        pool->parallelFor(songs.size(), task);
+    } else {
+        for (size_t s = 0; s < songs.size(); s++) task(s, 0);
+    }
+    for (size_t w = 1; w < workers; w++) builders[0].merge(std::move(builders[w]));
+    return builders[0].build();
+}
+
+// Fraction of reference's fingerprints (over every song) that other reproduces exactly
+double agreement(const std::vector<std::vector<fingerprint>> &reference,
+                 const std::vector<std::vector<fingerprint>> &other) {
+    size_t total = 0;
+    size_t common = 0;
+    std::vector<fingerprint> a;
+    std::vector<fingerprint> b;
+    std::vector<fingerprint> scratch;
+    for (size_t s = 0; s < reference.size(); s++) {
+        a = reference[s];
+        b = other[s];
+        sortFingerprints(a, scratch);
+        sortFingerprints(b, scratch);
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a.size() && j < b.size()) {
+            if (a[i] < b[j]) {
+                i++;
+            } else if (b[j] < a[i]) {
+                j++;
+            } else {
+                common++;
+                i++;
+                j++;
+            }
+        }
+        total += a.size();
+    }
+    return total ? double(common) / total : 1.0;
+}
+
+} // namespace
+
+void runMacroBenchmarks(BenchRunner &runner) {
+    if (!runner.enabled("e2e/catalog/float") && !runner.enabled("e2e/catalog/double") &&
+        !runner.enabled("e2e/recognize")) {
+        return;
+    }
+    const bool quick = runner.options().quick;
+    const size_t numOfSongs = quick ? 3 : MACRO_CATALOG_SONGS;
+    const double seconds = quick ? 20.0 : MACRO_SONG_SECONDS;
+    const size_t numOfQueries = quick ? 6 : MACRO_QUERIES;
+
+    std::vector<std::vector<float>> songs(numOfSongs);
+    double samples = 0;
+    for (size_t s = 0; s < numOfSongs; s++) {
+        songs[s] = syntheticSong(uint32_t(1000 + s), seconds);
+        samples += double(songs[s].size());
+    }
+    std::unique_ptr<ThreadPool> pool;
+    if (runner.options().threads > 1) pool = std::make_unique<ThreadPool>(runner.options().threads - 1);
+
+    // Catalog ingest in the production precision, then in double for reference; how many fingerprints the two
+    // share is how much the choice of precision matters to recognition
+    FingerprintIndex index;
+    std::vector<std::vector<fingerprint>> floatPrints;
+    const double songSamples = samples / numOfSongs;
+    if (BenchResult *result = runner.runOnce("e2e/catalog/float", numOfSongs, songSamples, "samples", [&] {
+            index = buildCatalog<float>(songs, pool.get(), floatPrints);
+        })) {
+        result->metrics.push_back({"songs", double(numOfSongs)});
+        result->metrics.push_back({"postings", double(index.numOfPostings())});
+        result->metrics.push_back({"index_bytes", double(index.sizeInBytes())});
+        result->metrics.push_back({"realtime_factor", result->itemsPerSecond() / SYNTHETIC_SAMPLE_RATE});
+    }
+    std::vector<std::vector<fingerprint>> doublePrints;
+    if (BenchResult *result = runner.runOnce("e2e/catalog/double", numOfSongs, songSamples, "samples", [&] {
+            FingerprintIndex reference = buildCatalog<double>(songs, pool.get(), doublePrints);
+            doNotOptimize(reference.numOfKeys());
+        })) {
+        result->metrics.push_back({"realtime_factor", result->itemsPerSecond() / SYNTHETIC_SAMPLE_RATE});
+        if (!floatPrints.empty()) {
+            result->metrics.push_back({"float_fingerprints_matching", agreement(doublePrints, floatPrints)});
+        }
+    }
+
+    if (!runner.enabled("e2e/recognize")) return;
+    if (!index) index = buildCatalog<float>(songs, pool.get(), floatPrints);
+
+    // Noisy excerpts from random places in random songs, made up front so only recognition is timed
+    std::mt19937 rng(11);
+    const size_t clipLength = size_t(MACRO_QUERY_SECONDS * SYNTHETIC_SAMPLE_RATE);
+    std::vector<Query> queries(numOfQueries);
+    for (size_t q = 0; q < numOfQueries; q++) {
+        queries[q].songId = uint32_t(rng() % numOfSongs);
+        const std::vector<float> &song = songs[queries[q].songId];
+        queries[q].start = rng() % (song.size() - clipLength);
+        queries[q].clip = noisyExcerpt(song, queries[q].start, clipLength, MACRO_QUERY_SNR_DB, uint32_t(q));
+    }
+
+    Matcher matcher(index, pool.get());
+    std::vector<fingerprint> prints;
+    size_t correct = 0;
+    size_t alignedCorrectly = 0;
+    double confidence = 0.0;
+    BenchResult *result = runner.runOnce("e2e/recognize", numOfQueries, double(clipLength), "samples", [&] {
+        for (const Query &query : queries) {
+            fingerprintSignal<sample_t>(query.clip, prints);
+            std::vector<MatchCandidate> candidates = matcher.match(prints);
+            if (candidates.empty() || candidates[0].songId != query.songId) continue;
+            correct++;
+            confidence += candidates[0].confidence;
+
+            // The excerpt starts this many STFT frames into the song
+            double expected = double(query.start) * FINGERPRINT_SAMPLE_RATE / SYNTHETIC_SAMPLE_RATE / HOP_SIZE;
+            if (std::abs(candidates[0].offset - expected) <= MACRO_FRAME_TOLERANCE) alignedCorrectly++;
+        }
+    });
+    if (result) {
+        result->metrics.push_back({"accuracy", double(correct) / numOfQueries});
+        result->metrics.push_back({"offset_accuracy", double(alignedCorrectly) / numOfQueries});
+        result->metrics.push_back({"mean_confidence", correct ? confidence / correct : 0.0});
+    }
+}
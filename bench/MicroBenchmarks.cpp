@@ -0,0 +1,338 @@
+// Microbenchmarks: each pipeline stage in isolation, on synthetic input built up front
+#include "Bench.h"
+#include "Fft.h"
+#include "FingerprintIndex.h"
+#include "FixedFft.h"
+#include "Matcher.h"
+#include "PcmDecode.h"
+#include "Peaks.h"
+#include "Render.h"
+#include "Resampler.h"
+#include "Spectrogram.h"
+#include "StreamingStft.h"
+#include "Synthetic.h"
+#include "Fingerprint.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace {
+
+// Whether any of a group's benchmarks will run, so groups with expensive setup can skip it
+bool anyEnabled(const BenchRunner &runner, const std::vector<std::string> &names) {
+    for (const std::string &name : names) {
+        if (runner.enabled(name)) return true;
+    }
+    return false;
+}
+
+const std::pair<PcmFormat, const char *> DECODE_FORMATS[] = {
+    {PcmFormat::U8, "u8"}, {PcmFormat::S16, "s16"}, {PcmFormat::S24, "s24"}, {PcmFormat::S32, "s32"},
+    {PcmFormat::F32, "f32"},
+};
+const char *const DECODE_LAYOUTS[] = {"stereo_to_mono/float", "stereo_to_mono/double", "stereo/float"};
+
+const std::pair<WindowFunction, const char *> WINDOW_FUNCTIONS[] = {
+    {Rectangle, "rectangle"}, {Triangle, "triangle"}, {Hanning, "hanning"}, {Hamming, "hamming"},
+};
+const int RESAMPLE_RATES[] = {SYNTHETIC_SAMPLE_RATE, 48000};
+
+template <typename Real>
+const char *precisionName() {
+    return std::is_same<Real, float>::value ? "float" : "double";
+}
+
+void fftBenchmarks(BenchRunner &runner) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+    for (size_t n = 256; n <= 8192; n *= 2) {
+        std::vector<double> in(n);
+        for (double &v : in) v = unit(rng);
+        FftPlan plan(n);
+        complex_vector out(plan.numOfRealBins());
+        runner.run("fft/plan/" + std::to_string(n), double(n), "samples", [&] {
+            plan.forwardReal(in.data(), out.data());
+            doNotOptimize(out[0]);
+        });
+        // The convenience wrapper allocates its full length output every call
+        runner.run("fft/FFT/" + std::to_string(n), double(n), "samples", [&] { doNotOptimize(FFT(in)); });
+    }
+}
+
+template <typename Real>
+void fixedFftBenchmarks(BenchRunner &runner) {
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    using FrameFft = Fft<FRAME_SIZE, Real>;
+
+    std::vector<Real> frame(FRAME_SIZE);
+    for (Real &v : frame) v = Real(unit(rng));
+    std::vector<std::complex<Real>> bins(FrameFft::numOfRealBins);
+    runner.run(std::string("fft/fixed/") + precisionName<Real>(), FRAME_SIZE, "samples", [&] {
+        FrameFft::forwardReal(frame.data(), bins.data());
+        doNotOptimize(bins[0]);
+    });
+
+    // A batch of FFT_BATCH_WIDTH frames, each pointing into one signal at successive hops like the STFT does
+    std::vector<Real> signal(FRAME_SIZE + FFT_BATCH_WIDTH * HOP_SIZE);
+    for (Real &v : signal) v = Real(unit(rng));
+    std::vector<Real> window(FRAME_SIZE, Real(1));
+    applyWindowFunction(window, Hamming);
+    std::vector<std::complex<Real>> batchBins(FFT_BATCH_WIDTH * FrameFft::numOfRealBins);
+    std::vector<Real> scratchRe(FFT_BATCH_WIDTH * FRAME_SIZE / 2);
+    std::vector<Real> scratchIm(FFT_BATCH_WIDTH * FRAME_SIZE / 2);
+    const Real *frames[FFT_BATCH_WIDTH];
+    std::complex<Real> *out[FFT_BATCH_WIDTH];
+    for (size_t f = 0; f < FFT_BATCH_WIDTH; f++) {
+        frames[f] = signal.data() + f * HOP_SIZE;
+        out[f] = batchBins.data() + f * FrameFft::numOfRealBins;
+    }
+    runner.run(std::string("fft/fixed_batch/") + precisionName<Real>(), FFT_BATCH_WIDTH * FRAME_SIZE, "samples",
+               [&] {
+                   FrameFft::forwardRealBatch(frames, out, FFT_BATCH_WIDTH, window.data(), scratchRe.data(),
+                                              scratchIm.data());
+                   doNotOptimize(batchBins[0]);
+               });
+}
+
+void decodeBenchmarks(BenchRunner &runner) {
+    std::vector<std::string> names;
+    for (const auto &format : DECODE_FORMATS) {
+        for (const char *layout : DECODE_LAYOUTS) {
+            names.push_back(std::string("decode/") + format.second + "/" + layout);
+        }
+    }
+    if (!anyEnabled(runner, names)) return;
+
+    const size_t frames = runner.options().quick ? 1 << 14 : 1 << 18;
+    std::vector<float> song = syntheticSong(3, double(frames) / SYNTHETIC_SAMPLE_RATE + 1.0);
+    song.resize(frames);
+
+    // What WavFile::extractSignal and MappedWavFile::readFrames run for each bit depth: stereo folded to mono
+    // (in either precision), or kept interleaved
+    std::vector<float> outFloat(2 * frames);
+    std::vector<double> outDouble(2 * frames);
+    const std::string *name = names.data();
+    for (const auto &[format, formatName] : DECODE_FORMATS) {
+        std::vector<uint8_t> stereo = encodePcm(song, format, 2);
+        runner.run(*name++, double(frames), "frames", [&, format = format] {
+            decodePcm(format, stereo.data(), frames, 2, outFloat.data(), true);
+            doNotOptimize(outFloat[0]);
+        });
+        runner.run(*name++, double(frames), "frames", [&, format = format] {
+            decodePcm(format, stereo.data(), frames, 2, outDouble.data(), true);
+            doNotOptimize(outDouble[0]);
+        });
+        runner.run(*name++, double(frames), "frames", [&, format = format] {
+            decodePcm(format, stereo.data(), frames, 2, outFloat.data(), false);
+            doNotOptimize(outFloat[0]);
+        });
+    }
+}
+
+template <typename Real>
+void filterBenchmarks(BenchRunner &runner) {
+    const std::string suffix = std::string("/") + precisionName<Real>();
+    std::vector<std::string> names = {"filter/low_pass" + suffix, "filter/downsample" + suffix};
+    for (int rate : RESAMPLE_RATES) names.push_back("filter/resample/" + std::to_string(rate) + suffix);
+    for (const auto &window : WINDOW_FUNCTIONS) names.push_back(std::string("window/") + window.second + suffix);
+    if (!anyEnabled(runner, names)) return;
+
+    const double seconds = runner.options().quick ? 1.0 : 10.0;
+    std::vector<float> song = syntheticSong(4, seconds);
+    const std::vector<Real> signal(song.begin(), song.end());
+    const double n = double(signal.size());
+
+    // Each op filters a fresh copy, since the filters work in place; the copy is a small part of the cost
+    std::vector<Real> work;
+    runner.run("filter/low_pass" + suffix, n, "samples", [&] {
+        work = signal;
+        applyLowPassFilter(work, SYNTHETIC_SAMPLE_RATE, MAX_FREQUENCY);
+        doNotOptimize(work[0]);
+    });
+    runner.run("filter/downsample" + suffix, n, "samples", [&] {
+        work = signal;
+        downsample(work, SYNTHETIC_SAMPLE_RATE, FINGERPRINT_SAMPLE_RATE);
+        doNotOptimize(work[0]);
+    });
+
+    // The polyphase resampler that replaced them, from the common source rates
+    for (int rate : RESAMPLE_RATES) {
+        PolyphaseResampler<Real> resampler(rate, FINGERPRINT_SAMPLE_RATE);
+        std::vector<Real> out(resampler.maxOutputFor(signal.size()));
+        runner.run("filter/resample/" + std::to_string(rate) + suffix, n, "samples", [&] {
+            resampler.reset();
+            size_t made = resampler.process(signal.data(), signal.size(), out.data());
+            made += resampler.flush(out.data() + made);
+            doNotOptimize(made);
+        });
+    }
+
+    // Refilled every op, or repeated windowing would decay the frame into (slow) denormals
+    std::vector<Real> frame(FRAME_SIZE);
+    for (const auto &[function, name] : WINDOW_FUNCTIONS) {
+        runner.run(std::string("window/") + name + suffix, FRAME_SIZE, "samples", [&, function = function] {
+            std::fill(frame.begin(), frame.end(), Real(1));
+            applyWindowFunction(frame, function);
+            doNotOptimize(frame[0]);
+        });
+    }
+}
+
+template <typename Real>
+void stftBenchmarks(BenchRunner &runner) {
+    const std::string suffix = std::string("/") + precisionName<Real>();
+    const std::string threaded = "stft/spectrogram" + suffix + "/threads_" + std::to_string(runner.options().threads);
+    if (!anyEnabled(runner, {"stft/spectrogram" + suffix, threaded, "stft/streaming" + suffix})) return;
+
+    const double seconds = runner.options().quick ? 2.0 : 30.0;
+    std::vector<float> song = syntheticSong(5, seconds);
+    const std::vector<Real> signal(song.begin(), song.end());
+    const double n = double(signal.size());
+
+    runner.run("stft/spectrogram" + suffix, n, "samples", [&] {
+        doNotOptimize(Spectrogram<MagnitudeStorage>(signal, SYNTHETIC_SAMPLE_RATE).numOfFrames());
+    });
+    if (runner.options().threads > 1) {
+        ThreadPool pool(runner.options().threads - 1); // Started once, like a long running caller would
+        runner.run(threaded, n, "samples", [&] {
+            auto s = Spectrogram<MagnitudeStorage>(signal, SYNTHETIC_SAMPLE_RATE, pool);
+            doNotOptimize(s.numOfFrames());
+        });
+    }
+
+    // Streaming in 4096 sample blocks, reducing each frame to magnitudes like ingest does
+    std::vector<float> magnitudes(FRAME_SIZE / 2 + 1);
+    runner.run("stft/streaming" + suffix, n, "samples", [&] {
+        StreamingStft<Real> stft(SYNTHETIC_SAMPLE_RATE, [&](size_t, const std::complex<Real> *bins) {
+            MagnitudeStorage::fromBins(bins, magnitudes.data(), magnitudes.size());
+        });
+        for (size_t i = 0; i < signal.size(); i += 4096) {
+            stft.push(signal.data() + i, std::min<size_t>(4096, signal.size() - i));
+        }
+        stft.flush();
+        doNotOptimize(magnitudes[0]);
+    });
+}
+
+void renderBenchmarks(BenchRunner &runner) {
+    if (!anyEnabled(runner, {"render/image/max", "render/image/mean"})) return;
+
+    // A long capture pooled down to the default image size, colormapped but not encoded
+    const double seconds = runner.options().quick ? 30.0 : 600.0;
+    spectrogram sgram = Spectrogram(syntheticSong(7, seconds), SYNTHETIC_SAMPLE_RATE);
+    SpectrogramView<const float> plot = sgram.view().transposed();
+    const double cells = double(plot.rows() * plot.cols());
+    for (Pooling pooling : {Pooling::Max, Pooling::Mean}) {
+        RenderParams params;
+        params.pooling = pooling;
+        runner.run(std::string("render/image/") + (pooling == Pooling::Max ? "max" : "mean"), cells, "cells", [&] {
+            doNotOptimize(renderSpectrogram(plot, params).rgb.data());
+        });
+    }
+}
+
+void fingerprintBenchmarks(BenchRunner &runner) {
+    if (!anyEnabled(runner, {"peaks/extract", "fingerprint/generate", "fingerprint/sort", "index/build",
+                             "index/lookup", "match/query"})) {
+        return;
+    }
+    const bool quick = runner.options().quick;
+    const size_t numOfSongs = quick ? 4 : 32;
+    const double seconds = quick ? 10.0 : 60.0;
+
+    // A catalog's fingerprints, from which every later stage is fed
+    std::vector<std::vector<fingerprint>> songs(numOfSongs);
+    spectrogram first;
+    for (size_t s = 0; s < numOfSongs; s++) {
+        spectrogram sgram = Spectrogram(syntheticSong(uint32_t(100 + s), seconds), SYNTHETIC_SAMPLE_RATE);
+        generateFingerprints(sgram.view(), songs[s]);
+        if (s == 0) first = std::move(sgram);
+    }
+
+    std::vector<Peak> peaks;
+    runner.run("peaks/extract", double(first.numOfFrames()), "frames", [&] {
+        peaks = extractPeaks(first.view());
+        doNotOptimize(peaks.size());
+    });
+
+    std::vector<fingerprint> hashes;
+    runner.run("fingerprint/generate", double(peaks.size()), "peaks", [&] {
+        generateFingerprints(peaks, hashes);
+        doNotOptimize(hashes.size());
+    });
+
+    std::vector<fingerprint> unsorted = hashes;
+    std::shuffle(unsorted.begin(), unsorted.end(), std::mt19937(6));
+    std::vector<fingerprint> sorting;
+    std::vector<fingerprint> scratch;
+    runner.run("fingerprint/sort", double(unsorted.size()), "hashes", [&] {
+        sorting = unsorted;
+        sortFingerprints(sorting, scratch);
+        doNotOptimize(sorting[0]);
+    });
+
+    size_t postings = 0;
+    for (const std::vector<fingerprint> &song : songs) postings += song.size();
+    FingerprintIndex index;
+    runner.run("index/build", double(postings), "postings", [&] {
+        FingerprintIndexBuilder builder;
+        for (size_t s = 0; s < numOfSongs; s++) builder.add(uint32_t(s), songs[s]);
+        index = builder.build();
+        doNotOptimize(index.numOfKeys());
+    });
+
+    // Lookups of hashes that are in the index, walking every posting like the matcher does
+    std::vector<uint32_t> probes;
+    for (size_t s = 0; s < numOfSongs; s++) {
+        for (size_t i = 0; i < songs[s].size(); i += 97) probes.push_back(fingerprintHash(songs[s][i]));
+    }
+    std::shuffle(probes.begin(), probes.end(), std::mt19937(7));
+    runner.run("index/lookup", double(probes.size()), "hashes", [&] {
+        uint64_t sum = 0;
+        for (uint32_t hash : probes) {
+            PostingList list = index.lookup(hash);
+            Posting posting;
+            while (list.next(posting)) sum += posting.anchorFrame;
+        }
+        doNotOptimize(sum);
+    });
+
+    // Matching a clean 10 s excerpt of a catalog song (its hashes are a subset of the song's)
+    std::vector<fingerprint> query;
+    {
+        std::vector<float> song = syntheticSong(100 + uint32_t(numOfSongs / 2), seconds);
+        std::vector<float> clip = noisyExcerpt(song, song.size() / 3, 10 * SYNTHETIC_SAMPLE_RATE, 20.0, 8);
+        generateFingerprints(Spectrogram(clip, SYNTHETIC_SAMPLE_RATE).view(), query);
+    }
+    std::unique_ptr<ThreadPool> pool;
+    if (runner.options().threads > 1) pool = std::make_unique<ThreadPool>(runner.options().threads - 1);
+    Matcher matcher(index, pool.get());
+    uint32_t found = 0;
+    if (BenchResult *result = runner.run("match/query", double(query.size()), "hashes", [&] {
+            std::vector<MatchCandidate> candidates = matcher.match(query);
+            found = candidates.empty() ? UINT32_MAX : candidates[0].songId;
+            doNotOptimize(found);
+        })) {
+        result->metrics.push_back({"correct", found == numOfSongs / 2 ? 1.0 : 0.0});
+        result->metrics.push_back({"hashes_looked_up", double(matcher.hashesLookedUp())});
+    }
+}
+
+} // namespace
+
+void runMicroBenchmarks(BenchRunner &runner) {
+    fftBenchmarks(runner);
+    fixedFftBenchmarks<float>(runner);
+    fixedFftBenchmarks<double>(runner);
+    decodeBenchmarks(runner);
+    filterBenchmarks<float>(runner);
+    filterBenchmarks<double>(runner);
+    stftBenchmarks<float>(runner);
+    stftBenchmarks<double>(runner);
+    renderBenchmarks(runner);
+    fingerprintBenchmarks(runner);
+}
@@ -0,0 +1,93 @@
+#include "Synthetic.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+std::vector<float> syntheticSong(uint32_t seed, double seconds, int sampleRate) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> noise(0.0, 0.005);
+
+    std::vector<float> song(size_t(seconds * sampleRate));
+    size_t pos = 0;
+    while (pos < song.size()) {
+        // A note of 100 - 400 ms: 3 partials spread log uniformly over 100 Hz - 4 kHz
+        size_t length = size_t((0.1 + 0.3 * unit(rng)) * sampleRate);
+        double freqs[3];
+        double amps[3];
+        for (int p = 0; p < 3; p++) {
+            freqs[p] = 100.0 * std::pow(40.0, unit(rng));
+            amps[p] = 0.1 + 0.2 * unit(rng);
+        }
+        double decay = 3.0 + 6.0 * unit(rng); // Per second
+
+        size_t end = std::min(song.size(), pos + length);
+        for (size_t i = pos; i < end; i++) {
+            double t = double(i - pos) / sampleRate;
+            double envelope = std::min(1.0, t * 200.0) * std::exp(-decay * t); // 5 ms attack
+            double v = 0.0;
+            for (int p = 0; p < 3; p++) v += amps[p] * std::sin(2 * M_PI * freqs[p] * t);
+            song[i] = float(std::clamp(envelope * v + noise(rng), -1.0, 1.0));
+        }
+        pos = end;
+    }
+    return song;
+}
+
+std::vector<float> noisyExcerpt(const std::vector<float> &song, size_t start, size_t length, double snrDb,
+                                uint32_t seed) {
+    start = std::min(start, song.size());
+    length = std::min(length, song.size() - start);
+    std::vector<float> clip(song.begin() + start, song.begin() + start + length);
+
+    double power = 0.0;
+    for (float v : clip) power += double(v) * v;
+    power /= std::max<size_t>(1, clip.size());
+
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, std::sqrt(power / std::pow(10.0, snrDb / 10.0)));
+    for (float &v : clip) v = float(std::clamp(v + noise(rng), -1.0, 1.0));
+    return clip;
+}
+
+std::vector<uint8_t> encodePcm(const std::vector<float> &samples, PcmFormat format, size_t channels) {
+    size_t bytes = pcmBytesPerSample(format);
+    std::vector<uint8_t> out(samples.size() * channels * bytes);
+    uint8_t *dst = out.data();
+    for (float sample : samples) {
+        double v = std::clamp(double(sample), -1.0, 1.0);
+        for (size_t c = 0; c < channels; c++, dst += bytes) {
+            switch (format) {
+                case PcmFormat::U8:
+                    *dst = uint8_t(std::lround(v * 127.0) + 128);
+                    break;
+                case PcmFormat::S16: {
+                    int16_t s = int16_t(std::lround(v * 32767.0));
+                    std::memcpy(dst, &s, 2);
+                    break;
+                }
+                case PcmFormat::S24: {
+                    int32_t s = int32_t(std::lround(v * 8388607.0));
+                    dst[0] = uint8_t(s);
+                    dst[1] = uint8_t(s >> 8);
+                    dst[2] = uint8_t(s >> 16);
+                    break;
+                }
+                case PcmFormat::S32: {
+                    int32_t s = int32_t(std::lround(v * 2147483647.0));
+                    std::memcpy(dst, &s, 4);
+                    break;
+                }
+                case PcmFormat::F32: {
+                    float s = float(v);
+                    std::memcpy(dst, &s, 4);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "PcmDecode.h"
+
+#define SYNTHETIC_SAMPLE_RATE 44100 // Rate every synthetic signal is generated at (CD audio)
+
+/**
+ * A deterministic stand-in for a song: a sequence of notes, each a chord of a few partials at random pitches
+ * (roughly 100 Hz to 4 kHz) under a percussive envelope, over a faint noise floor. Different seeds give unrelated
+ * songs, so a catalog of them exercises fingerprinting and matching much like real music does.
+ *
+ * @param seed Which song.
+ * @param seconds The length of the song.
+ * @param sampleRate The sample rate to generate at.
+ * @return The mono samples, within [-1, 1].
+ */
+std::vector<float> syntheticSong(uint32_t seed, double seconds, int sampleRate = SYNTHETIC_SAMPLE_RATE);
+
+/**
+ * A query clip as a microphone might hear it: an excerpt of a signal with white noise added.
+ *
+ * @param song The signal to take the excerpt from.
+ * @param start The first sample of the excerpt.
+ * @param length The number of samples in the excerpt.
+ * @param snrDb The signal to noise ratio of the result in decibels.
+ * @param seed Seeds the noise.
+ */
+std::vector<float> noisyExcerpt(const std::vector<float> &song, size_t start, size_t length, double snrDb,
+                                uint32_t seed);
+
+/**
+ * Encode samples as interleaved PCM of any supported format (the inverse of decodePcm), duplicating the signal
+ * into every channel.
+ *
+ * @param samples Mono samples within [-1, 1].
+ * @param format The encoding to produce.
+ * @param channels The number of channels per frame.
+ * @return The encoded sample frames, as they would appear in a .wav data chunk.
+ */
+std::vector<uint8_t> encodePcm(const std::vector<float> &samples, PcmFormat format, size_t channels);
@@ -0,0 +1,67 @@
+#include "Bench.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+/**
+ * intune_bench: micro and macro benchmarks of the decode, resample, FFT, STFT, fingerprint and matching stages
+ * over synthetic signals. Progress goes to stderr and the results, as JSON, to stdout or --json <file>, so runs
+ * can be diffed to catch regressions. --metrics <file> also writes the per stage totals of every run (see
+ * signal_processor/Metrics.h).
+ */
+int main(int argc, char **argv) {
+    BenchOptions options;
+    std::string jsonPath;
+    std::string metricsPath;
+    bool micro = true;
+    bool macro = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else if (arg == "--metrics" && hasValue) {
+            metricsPath = argv[++i];
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--min-time" && hasValue) {
+            options.minSeconds = std::atof(argv[++i]);
+        } else if (arg == "--repetitions" && hasValue) {
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--quick") {
+            options.quick = true;
+            options.minSeconds = 0.02;
+            options.repetitions = 1;
+        } else if (arg == "--micro") {
+            macro = false;
+        } else if (arg == "--macro") {
+            micro = false;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--json <file>] [--metrics <file[.prom]>] [--filter <substring>]"
+                      << " [--min-time <seconds>] [--repetitions <n>] [--threads <n>] [--quick] [--micro | --macro]\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    BenchRunner runner(options);
+    if (micro) runMicroBenchmarks(runner);
+    if (macro) runMacroBenchmarks(runner);
+    if (!metricsPath.empty() && !writeMetrics(metricsPath)) return 1;
+
+    if (jsonPath.empty()) {
+        runner.writeJson(std::cout);
+        return 0;
+    }
+    std::ofstream out(jsonPath);
+    if (!out) {
+        std::cerr << "Failed to open file: " << jsonPath << "\n";
+        return 1;
+    }
+    runner.writeJson(out);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "Fingerprint.h"
+#include <algorithm>
+#include <cstdlib>
+
+size_t generateFingerprints(const std::vector<Peak> &peaks, std::vector<fingerprint> &out,
+                            const FingerprintParams &params) {
+    out.clear();
+    out.reserve(peaks.size() * params.fanOut);
+
+    // Deltas wider than HASH_DELTA_BITS would alias, so the zone is cut short there
+    uint32_t zoneEnd = std::min<uint32_t>(params.zoneStart + params.zoneFrames, 1u << HASH_DELTA_BITS);
+    size_t first = 0; // First peak that may still be in the current anchor's zone
+    for (size_t i = 0; i < peaks.size(); i++) {
+        const Peak &anchor = peaks[i];
+        while (first < peaks.size() && peaks[first].frame < anchor.frame + params.zoneStart) first++;
+
+        size_t paired = 0;
+        for (size_t j = std::max(first, i + 1); j < peaks.size() && paired < params.fanOut; j++) {
+            uint32_t delta = peaks[j].frame - anchor.frame;
+            if (delta >= zoneEnd) break;
+            if (std::abs(int(peaks[j].bin) - int(anchor.bin)) > int(params.zoneBins)) continue;
+            out.push_back(makeFingerprint(packHash(anchor.bin, peaks[j].bin, delta), anchor.frame));
+            paired++;
+        }
+    }
+    return out.size();
+}
+
+size_t generateFingerprints(SpectrogramView<const float> s, std::vector<fingerprint> &out,
+                            const FingerprintParams &params) {
+    return generateFingerprints(extractPeaks(s, params.peaks), out, params);
+}
+
+void sortFingerprints(std::vector<fingerprint> &fingerprints, std::vector<fingerprint> &scratch) {
+    radixSort(fingerprints, scratch, [](fingerprint f) { return f; }, 64);
+}
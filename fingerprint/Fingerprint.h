@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Peaks.h"
+
+#define FAN_OUT 5 // Target peaks paired with each anchor peak
+#define TARGET_ZONE_START 1 // Frames after the anchor where its target zone begins
+#define TARGET_ZONE_FRAMES 128 // Length of the target zone in frames (~370 ms at HOP_SIZE)
+#define TARGET_ZONE_BINS 64 // Bins either side of the anchor's the target zone spans (~690 Hz)
+
+// Field widths of a packed hash: anchor bin | target bin | frames between them
+#define HASH_BIN_BITS 10
+#define HASH_DELTA_BITS 12
+
+/**
+ * A fingerprint packs one (anchor peak, target peak) pair into a single uint64_t: the 32-bit hash of the pair in
+ * the high half and the anchor's frame in the low half. Sorting fingerprints as plain integers therefore groups
+ * equal hashes together in time order, which is exactly the order an index is built in.
+ */
+using fingerprint = uint64_t;
+
+inline uint32_t packHash(uint32_t anchorBin, uint32_t targetBin, uint32_t deltaFrames) {
+    const uint32_t binMask = (1u << HASH_BIN_BITS) - 1;
+    const uint32_t deltaMask = (1u << HASH_DELTA_BITS) - 1;
+    return (anchorBin & binMask) << (HASH_BIN_BITS + HASH_DELTA_BITS) | (targetBin & binMask) << HASH_DELTA_BITS |
+           (deltaFrames & deltaMask);
+}
+
+inline fingerprint makeFingerprint(uint32_t hash, uint32_t anchorFrame) { return uint64_t(hash) << 32 | anchorFrame; }
+inline uint32_t fingerprintHash(fingerprint f) { return uint32_t(f >> 32); }
+inline uint32_t fingerprintFrame(fingerprint f) { return uint32_t(f); }
+
+// How peaks are paired into fingerprints; more fan out or a bigger zone means more hashes (a bigger index) but
+// better odds of some surviving noise
+struct FingerprintParams {
+    PeakParams peaks;
+    size_t fanOut = FAN_OUT;
+    uint32_t zoneStart = TARGET_ZONE_START;
+    uint32_t zoneFrames = TARGET_ZONE_FRAMES; // zoneStart + zoneFrames must fit in HASH_DELTA_BITS
+    uint32_t zoneBins = TARGET_ZONE_BINS;
+};
+
+/**
+ * Pair every peak (as an anchor) with up to fanOut later peaks inside its target zone: zoneStart to zoneStart +
+ * zoneFrames - 1 frames later and at most zoneBins bins away, nearest in time first.
+ *
+ * @param peaks Peaks sorted by frame (as extractPeaks returns them).
+ * @param out Receives the fingerprints, in anchor order. It is cleared first and its capacity is reused, so a
+ * buffer kept across calls stops allocating once it has grown to the largest input.
+ * @param params Fan out and target zone.
+ * @return The number of fingerprints written.
+ */
+size_t generateFingerprints(const std::vector<Peak> &peaks, std::vector<fingerprint> &out,
+                            const FingerprintParams &params = {});
+
+/**
+ * Extract the peaks of a spectrogram and fingerprint them.
+ *
+ * @param s A view of the cells indexed [time][frequency], e.g. spectrogram.view().
+ * @param out Receives the fingerprints (see above).
+ * @param params Peak picking, fan out and target zone.
+ * @return The number of fingerprints written.
+ */
+size_t generateFingerprints(SpectrogramView<const float> s, std::vector<fingerprint> &out,
+                            const FingerprintParams &params = {});
+
+/**
+ * Sort fingerprints ascending (by hash, then anchor frame) with radixSort. The digits of a short song's frames
+ * above its length are all zero, so those passes are skipped.
+ *
+ * @param fingerprints The fingerprints to sort.
+ * @param scratch A buffer the sort may use, resized to match; keep it across calls to avoid allocating.
+ */
+void sortFingerprints(std::vector<fingerprint> &fingerprints, std::vector<fingerprint> &scratch);
+
+/**
+ * Stable LSD radix sort by an unsigned integer key, 11 bits per pass (2048 buckets, so counts and write heads
+ * stay in L1). Passes whose digit is the same for every item are skipped, so keys that only use a few low bits
+ * cost only the passes those bits need.
+ *
+ * @param items The items to sort.
+ * @param scratch A buffer the sort may use, resized to match; keep it across calls to avoid allocating.
+ * @param key Maps an item to its key (any unsigned integer type).
+ * @param keyBits The number of low key bits to sort on, at most 64.
+ */
+template <typename T, typename Key>
+void radixSort(std::vector<T> &items, std::vector<T> &scratch, Key key, size_t keyBits) {
+    constexpr size_t digitBits = 11;
+    constexpr size_t buckets = size_t(1) << digitBits;
+    constexpr size_t maxPasses = (64 + digitBits - 1) / digitBits; // Enough for any key up to 64 bits
+    const size_t passes = (std::min<size_t>(keyBits, 64) + digitBits - 1) / digitBits;
+    size_t n = items.size();
+    scratch.resize(n);
+
+    // Histogram every digit in one read of the input, into a fixed array on the stack so sorting never allocates
+    // (beyond growing scratch)
+    std::array<size_t, maxPasses * buckets> counts;
+    std::fill_n(counts.data(), passes * buckets, size_t(0));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = key(items[i]);
+        for (size_t p = 0; p < passes; p++) counts[p * buckets + ((k >> (p * digitBits)) & (buckets - 1))]++;
+    }
+
+    T *src = items.data();
+    T *dst = scratch.data();
+    for (size_t p = 0; p < passes && n > 0; p++) {
+        size_t shift = p * digitBits;
+        size_t *heads = counts.data() + p * buckets;
+        if (heads[(uint64_t(key(src[0])) >> shift) & (buckets - 1)] == n) continue;
+
+        size_t offset = 0;
+        for (size_t d = 0; d < buckets; d++) offset += std::exchange(heads[d], offset);
+        for (size_t i = 0; i < n; i++) dst[heads[(uint64_t(key(src[i])) >> shift) & (buckets - 1)]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != items.data()) std::copy(src, src + n, items.data());
+}
@@ -0,0 +1,287 @@
+#include "FingerprintCache.h"
+#include "FingerprintIndex.h"
+#include "Metrics.h"
+#include "Resampler.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+
+/*---------XXH64----------*/
+
+constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotateLeft(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const uint8_t *p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t mixLane(uint64_t acc, uint64_t input) {
+    return rotateLeft(acc + input * PRIME2, 31) * PRIME1;
+}
+
+inline uint64_t mergeLane(uint64_t acc, uint64_t lane) {
+    return (acc ^ mixLane(0, lane)) * PRIME1 + PRIME4;
+}
+
+// A floating point key field by its bits, so every distinct value hashes differently
+uint64_t bitsOf(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/*---------Entries----------*/
+
+static_assert(sizeof(CachedPeak) == 12, "CachedPeak must have no padding");
+
+size_t alignSection(size_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+// Byte offsets of each section of an entry, from its header
+struct SectionLayout {
+    size_t peaks, fingerprints, spectrogram, end;
+
+    explicit SectionLayout(const FingerprintCacheHeader &h) {
+        peaks = alignSection(sizeof(FingerprintCacheHeader));
+        fingerprints = alignSection(peaks + h.numOfPeaks * sizeof(CachedPeak));
+        spectrogram = alignSection(fingerprints + h.numOfFingerprints * sizeof(fingerprint));
+        end = spectrogram + h.numOfFrames * h.numOfBins;
+    }
+};
+
+// Quantize a magnitude spectrogram to CACHE_DB_STEP decibel steps below its loudest cell, one byte a cell
+void quantizeSpectrogram(const spectrogram &s, FingerprintCacheHeader &h, uint8_t *out) {
+    float loudest = float(LogMagnitudeStorage::MIN_MAGNITUDE);
+    for (size_t t = 0; t < s.numOfFrames(); t++) {
+        loudest = std::max(loudest, *std::max_element(s.row(t), s.row(t) + s.numOfBins()));
+    }
+    magnitudesToDecibels(&loudest, &h.topDb, 1);
+    h.dbStep = CACHE_DB_STEP;
+    float bottom = h.topDb - 255 * h.dbStep;
+
+    std::vector<float> row(s.numOfBins());
+    for (size_t t = 0; t < s.numOfFrames(); t++, out += s.numOfBins()) {
+        magnitudesToDecibels(s.row(t), row.data(), row.size());
+        for (size_t k = 0; k < row.size(); k++) {
+            float steps = std::min(std::max((row[k] - bottom) / h.dbStep + 0.5f, 0.0f), 255.0f);
+            out[k] = uint8_t(steps);
+        }
+    }
+}
+
+} // namespace
+
+uint64_t contentHash(const void *data, size_t size, uint64_t seed) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    const uint8_t *end = p + size;
+    uint64_t h;
+    if (size >= 32) {
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        do {
+            v1 = mixLane(v1, read64(p));
+            v2 = mixLane(v2, read64(p + 8));
+            v3 = mixLane(v3, read64(p + 16));
+            v4 = mixLane(v4, read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        h = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        h = mergeLane(h, v1);
+        h = mergeLane(h, v2);
+        h = mergeLane(h, v3);
+        h = mergeLane(h, v4);
+    } else {
+        h = seed + PRIME5;
+    }
+    h += size;
+
+    for (; end - p >= 8; p += 8) h = rotateLeft(h ^ mixLane(0, read64(p)), 27) * PRIME1 + PRIME4;
+    if (end - p >= 4) {
+        h = rotateLeft(h ^ (read32(p) * PRIME1), 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) h = rotateLeft(h ^ (*p * PRIME5), 11) * PRIME1;
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string CacheKey::name() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string name(32, '0');
+    for (size_t i = 0; i < 16; i++) {
+        name[i] = digits[(content >> (60 - 4 * i)) & 0xF];
+        name[16 + i] = digits[(params >> (60 - 4 * i)) & 0xF];
+    }
+    return name;
+}
+
+CacheKey cacheKey(const MappedWavFile &file, const FingerprintParams &params, WindowFunction window) {
+    INTUNE_STAGE(Stage::Cache, file.dataSize());
+    CacheKey key;
+    key.content = contentHash(file.data(), file.dataSize());
+    key.dataBytes = file.dataSize();
+
+    std::vector<uint64_t> fields = {
+        FINGERPRINT_CACHE_VERSION, file.header.audioFormat, file.header.numChannels, file.header.sampleRate,
+        file.header.bitsPerSample, FRAME_SIZE, HOP_SIZE, DOWNSAMPLE_RATIO, MAX_FREQUENCY, FINGERPRINT_SAMPLE_RATE,
+        uint64_t(window), sizeof(sample_t), RESAMPLER_ZERO_CROSSINGS, bitsOf(RESAMPLER_KAISER_BETA),
+        bitsOf(RESAMPLER_ROLLOFF), params.peaks.timeRadius, params.peaks.frequencyRadius,
+        bitsOf(params.peaks.minMagnitude), params.peaks.peaksPerBand, params.fanOut, params.zoneStart,
+        params.zoneFrames, params.zoneBins,
+    };
+    fields.insert(fields.end(), params.peaks.bandStarts.begin(), params.peaks.bandStarts.end());
+    key.params = contentHash(fields.data(), fields.size() * sizeof(uint64_t));
+    return key;
+}
+
+bool CacheEntry::open(const std::string &filePath, const CacheKey &key) {
+    *this = CacheEntry();
+    if (!file.open(filePath)) return false;
+    if (!attach(file.data(), file.size(), key)) {
+        std::cerr << "Not a valid version " << FINGERPRINT_CACHE_VERSION << " cache entry: " << filePath << "\n";
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+bool CacheEntry::attach(const uint8_t *data, size_t length, const CacheKey &key) {
+    if (length < sizeof(FingerprintCacheHeader)) return false;
+    const FingerprintCacheHeader *h = reinterpret_cast<const FingerprintCacheHeader *>(data);
+    if (std::memcmp(h->magic, FINGERPRINT_CACHE_MAGIC, sizeof(h->magic)) != 0) return false;
+    if (h->version != FINGERPRINT_CACHE_VERSION) return false;
+    if (h->contentHash != key.content || h->dataBytes != key.dataBytes || h->paramsHash != key.params) return false;
+    if (h->numOfPeaks > length || h->numOfFingerprints > length || h->numOfFrames > length) return false;
+
+    SectionLayout layout(*h);
+    if (layout.end != length) return false;
+
+    header = h;
+    peakCells = reinterpret_cast<const CachedPeak *>(data + layout.peaks);
+    fingerprintCells = reinterpret_cast<const fingerprint *>(data + layout.fingerprints);
+    spectrogramCells = data + layout.spectrogram;
+    return true;
+}
+
+void CacheEntry::copyPeaks(std::vector<Peak> &out) const {
+    out.resize(numOfPeaks());
+    for (size_t i = 0; i < out.size(); i++) out[i] = {peakCells[i].frame, peakCells[i].bin, peakCells[i].mag};
+}
+
+SpectrogramMatrix<LogMagnitudeStorage> CacheEntry::spectrogram() const {
+    if (!hasSpectrogram()) return {};
+    SpectrogramMatrix<LogMagnitudeStorage> s(header->numOfFrames, header->numOfBins);
+    float bottom = header->topDb - 255 * header->dbStep;
+    const uint8_t *cells = spectrogramCells;
+    for (size_t t = 0; t < s.numOfFrames(); t++, cells += s.numOfBins()) {
+        float *row = s.row(t);
+        for (size_t k = 0; k < s.numOfBins(); k++) row[k] = bottom + cells[k] * header->dbStep;
+    }
+    return s;
+}
+
+FingerprintCache::FingerprintCache(std::string directory) : directory(std::move(directory)) {}
+
+std::string FingerprintCache::path(const CacheKey &key) const {
+    std::string name = key.name();
+    return (std::filesystem::path(directory) / name.substr(0, 2) / (name + ".fpc")).string();
+}
+
+bool FingerprintCache::lookup(const CacheKey &key, CacheEntry &entry) const {
+    if (directory.empty()) return false;
+    INTUNE_STAGE(Stage::Cache);
+    std::string entryPath = path(key);
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(entryPath, error)) return false; // A miss; MappedFile would complain
+    return entry.open(entryPath, key);
+}
+
+bool FingerprintCache::store(const CacheKey &key, const std::vector<Peak> &peaks,
+                             const std::vector<fingerprint> &fingerprints, double audioSeconds,
+                             const spectrogram *s) const {
+    if (directory.empty()) return false;
+    INTUNE_STAGE(Stage::Cache);
+
+    FingerprintCacheHeader h = {};
+    std::memcpy(h.magic, FINGERPRINT_CACHE_MAGIC, sizeof(h.magic));
+    h.version = FINGERPRINT_CACHE_VERSION;
+    h.contentHash = key.content;
+    h.dataBytes = key.dataBytes;
+    h.paramsHash = key.params;
+    h.numOfPeaks = peaks.size();
+    h.numOfFingerprints = fingerprints.size();
+    h.audioSeconds = audioSeconds;
+    if (s && !s->empty()) {
+        h.numOfFrames = s->numOfFrames();
+        h.numOfBins = uint32_t(s->numOfBins());
+    }
+
+    SectionLayout layout(h);
+    std::vector<uint8_t> image(layout.end, 0);
+    if (h.numOfFrames) quantizeSpectrogram(*s, h, image.data() + layout.spectrogram);
+    std::memcpy(image.data(), &h, sizeof(h));
+    // Field by field, so Peak's padding (whatever bytes it held) never reaches the file
+    for (size_t i = 0; i < peaks.size(); i++) {
+        CachedPeak peak = {peaks[i].frame, peaks[i].bin, 0, peaks[i].mag};
+        std::memcpy(image.data() + layout.peaks + i * sizeof(CachedPeak), &peak, sizeof(CachedPeak));
+    }
+    if (!fingerprints.empty()) {
+        std::memcpy(image.data() + layout.fingerprints, fingerprints.data(), fingerprints.size() * sizeof(fingerprint));
+    }
+    INTUNE_STAGE_ITEMS(image.size());
+
+    // Written under a name no other thread or process uses, then renamed over the entry in one step
+    static std::atomic<uint64_t> writes{0};
+    std::filesystem::path entryPath = path(key);
+    std::filesystem::path temporary = entryPath;
+    temporary += ".tmp" + std::to_string(::getpid()) + "." + std::to_string(writes++);
+    std::error_code error;
+    std::filesystem::create_directories(entryPath.parent_path(), error);
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(image.data()), std::streamsize(image.size()));
+        if (!out) {
+            std::cerr << "Failed to write cache entry: " << temporary.string() << "\n";
+            out.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, entryPath, error);
+    if (error) {
+        std::cerr << "Failed to write cache entry: " << entryPath.string() << "\n";
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
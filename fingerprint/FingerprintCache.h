@@ -0,0 +1,181 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Fingerprint.h"
+#include "MappedFile.h"
+#include "Peaks.h"
+#include "Spectrogram.h"
+#include "Wav.h"
+
+#define FINGERPRINT_CACHE_MAGIC "INTUNEFC" // First 8 bytes of a cache entry
+// Bumped whenever the layout below changes, or the pipeline's output changes in a way cacheKey does not see (a
+// constant or algorithm it does not hash), so stale entries stop matching
+#define FINGERPRINT_CACHE_VERSION 1
+#define CACHE_DB_STEP 0.5f // Decibels per step of a stored spectrogram cell, so 255 steps span 127.5 dB
+
+/**
+ * XXH64, a non-cryptographic 64-bit hash that runs at memory bandwidth: four independent multiply and rotate
+ * lanes over 32 byte stripes, then an avalanche so every input bit affects every output bit.
+ *
+ * @param data The bytes to hash.
+ * @param size The number of bytes.
+ * @param seed Gives an unrelated hash of the same bytes.
+ * @return The hash, identical to the reference XXH64 implementation's.
+ */
+uint64_t contentHash(const void *data, size_t size, uint64_t seed = 0);
+
+// What a cache entry is addressed by: the audio itself and everything else its fingerprints depend on
+struct CacheKey {
+    uint64_t content = 0; // contentHash of the data chunk
+    uint64_t dataBytes = 0; // Size of the data chunk, checked on lookup so a hash collision needs equal sizes too
+    uint64_t params = 0; // Hash of the sample format and the pipeline and fingerprint parameters
+
+    // 32 hex digits, content then params
+    std::string name() const;
+};
+
+/**
+ * Key a .wav file's fingerprints by content. Hashing reads the whole data chunk (through the file's mapping, so
+ * nothing is copied) but decodes none of it.
+ *
+ * The parameter hash covers the sample format, FRAME_SIZE, HOP_SIZE, DOWNSAMPLE_RATIO, MAX_FREQUENCY,
+ * FINGERPRINT_SAMPLE_RATE, the window, the precision of sample_t, the resampler's RESAMPLER_ZERO_CROSSINGS,
+ * RESAMPLER_KAISER_BETA and RESAMPLER_ROLLOFF and every fingerprint parameter, so changing any of them misses
+ * rather than returning stale fingerprints. Renamed or copied files hit.
+ *
+ * @note Any other change to what the pipeline outputs (a new constant, a changed algorithm) must either be added
+ * to the hash or bump FINGERPRINT_CACHE_VERSION.
+ *
+ * @param file The mapped file.
+ * @param params The fingerprint parameters the entry is (or will be) made with.
+ * @param window The STFT window the entry is (or will be) made with.
+ * @return The key.
+ */
+CacheKey cacheKey(const MappedWavFile &file, const FingerprintParams &params = {}, WindowFunction window = Hamming);
+
+// A Peak as stored in an entry: its fields at fixed offsets and the padding explicitly zero, so the same peaks
+// always write the same bytes
+struct CachedPeak {
+    uint32_t frame;
+    uint16_t bin;
+    uint16_t reserved; // Always 0
+    float mag;
+};
+
+/**
+ * The fixed size start of a cache entry, followed by its sections (each SECTION_ALIGNMENT aligned, in order):
+ *
+ *  peaks         numOfPeaks CachedPeak: the spectral peaks, in frame order
+ *  fingerprints  numOfFingerprints fingerprint: the packed fingerprints made from them
+ *  spectrogram   numOfFrames * numOfBins uint8_t: optional, row per frame, cell q is topDb - (255 - q) * dbStep
+ *                decibels (0 is that or quieter)
+ *
+ * @note Like an index file, all fields are little endian and a mapping of the file is used as is.
+ */
+struct FingerprintCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numOfBins; // Bins per stored spectrogram frame; 0 if no spectrogram is stored
+    uint64_t contentHash;
+    uint64_t dataBytes;
+    uint64_t paramsHash;
+    uint64_t numOfPeaks;
+    uint64_t numOfFingerprints;
+    uint64_t numOfFrames; // Stored spectrogram frames
+    double audioSeconds;
+    float topDb; // Decibels of a stored cell of 255
+    float dbStep;
+    uint64_t reserved[2];
+};
+
+/**
+ * One cache entry, opened by mapping its file: peaks and fingerprints are read straight out of the mapping.
+ */
+class CacheEntry {
+public:
+    CacheEntry() = default;
+
+    /**
+     * Map a cache entry.
+     *
+     * @param filePath The entry's file.
+     * @param key The key it must have been stored under.
+     * @return True if and only if the file was mapped and is a valid entry of this version for key.
+     */
+    bool open(const std::string &filePath, const CacheKey &key);
+
+    const CachedPeak *peaks() const { return peakCells; }
+    size_t numOfPeaks() const { return header ? header->numOfPeaks : 0; }
+    const fingerprint *fingerprints() const { return fingerprintCells; }
+    size_t numOfFingerprints() const { return header ? header->numOfFingerprints : 0; }
+    double audioSeconds() const { return header ? header->audioSeconds : 0.0; }
+    bool hasSpectrogram() const { return header && header->numOfFrames > 0 && header->numOfBins > 0; }
+    operator bool() const { return header != nullptr; }
+
+    /**
+     * @param out Receives the stored peaks, replacing its contents.
+     */
+    void copyPeaks(std::vector<Peak> &out) const;
+
+    /**
+     * @return The stored spectrogram, expanded back to decibels and indexed [time][frequency]; empty if none was
+     * stored.
+     */
+    SpectrogramMatrix<LogMagnitudeStorage> spectrogram() const;
+
+private:
+    MappedFile file;
+    const FingerprintCacheHeader *header = nullptr;
+    const CachedPeak *peakCells = nullptr;
+    const fingerprint *fingerprintCells = nullptr;
+    const uint8_t *spectrogramCells = nullptr;
+
+    bool attach(const uint8_t *data, size_t length, const CacheKey &key);
+};
+
+/**
+ * A directory of cache entries, one file per key at directory/<first 2 hex digits>/<key name>.fpc so no single
+ * directory grows huge. Entries are written to a temporary file and renamed into place, so concurrent ingests
+ * (threads or processes) sharing a directory never see a partial entry; the last writer of a key wins.
+ *
+ * Nothing is ever evicted: delete the directory (or any entries in it) to reclaim space.
+ */
+class FingerprintCache {
+public:
+    FingerprintCache() = default; // Disabled: every lookup misses and every store is skipped
+
+    /**
+     * @param directory Where entries live; created on the first store. Empty disables the cache.
+     */
+    explicit FingerprintCache(std::string directory);
+
+    /**
+     * @param key The key to look up.
+     * @param entry Receives the entry on a hit.
+     * @return True if and only if a valid entry for key exists. A missing entry costs one failed stat.
+     */
+    bool lookup(const CacheKey &key, CacheEntry &entry) const;
+
+    /**
+     * Store a file's fingerprints, and optionally its spectrogram compressed to one byte a cell (CACHE_DB_STEP
+     * decibel steps below its loudest cell, a quarter of its float size).
+     *
+     * @param key The file's key.
+     * @param peaks The file's peaks.
+     * @param fingerprints The fingerprints generated from them.
+     * @param audioSeconds The file's duration.
+     * @param s The file's magnitude spectrogram, or nullptr to store only peaks and fingerprints.
+     * @return True if and only if the entry was written.
+     */
+    bool store(const CacheKey &key, const std::vector<Peak> &peaks, const std::vector<fingerprint> &fingerprints,
+               double audioSeconds, const spectrogram *s = nullptr) const;
+
+    // The file an entry for key lives in
+    std::string path(const CacheKey &key) const;
+
+    operator bool() const { return !directory.empty(); }
+
+private:
+    std::string directory;
+};
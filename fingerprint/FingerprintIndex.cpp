@@ -0,0 +1,287 @@
+#include "FingerprintIndex.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Write all of data to a new file and flush it to the device, so nothing renamed over an index is still in flight
+bool writeDurably(const std::string &filePath, const void *data, size_t size) {
+    int fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    const char *pos = static_cast<const char *>(data);
+    bool ok = true;
+    while (ok && size > 0) {
+        ssize_t written = ::write(fd, pos, size);
+        if (written < 0 && errno == EINTR) continue;
+        ok = written > 0;
+        if (ok) {
+            pos += written;
+            size -= size_t(written);
+        }
+    }
+    ok = ok && ::fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+}
+
+// Flush a directory's entries, so a rename within it survives a power loss
+void syncDirectory(const std::filesystem::path &directory) {
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+}
+
+size_t alignSection(size_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+// LEB128: 7 bits a byte, low bits first, high bit set on every byte but the last
+void writeVarint(std::vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+bool readVarint(const uint8_t *&pos, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for (size_t shift = 0; pos < end && shift < 64; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false; // Truncated (or corrupt) list
+}
+
+uint32_t directoryPrefix(uint32_t hash, uint32_t directoryBits) {
+    return directoryBits == 0 ? 0 : hash >> (32 - directoryBits);
+}
+
+// Byte offsets of the sections following the header, given its counts
+struct SectionLayout {
+    size_t directory;
+    size_t bases;
+    size_t keys;
+    size_t offsets;
+    size_t postings;
+    size_t end;
+
+    explicit SectionLayout(const FingerprintIndexHeader &h) {
+        size_t prefixes = (size_t(1) << h.directoryBits) + 1;
+        directory = alignSection(sizeof(FingerprintIndexHeader));
+        bases = alignSection(directory + prefixes * sizeof(uint32_t));
+        keys = bases + prefixes * sizeof(uint64_t);
+        offsets = keys + h.numOfKeys * sizeof(uint32_t);
+        postings = offsets + h.numOfKeys * sizeof(uint32_t);
+        end = postings + h.postingBytes;
+    }
+};
+
+} // namespace
+
+PostingList::PostingList(const uint8_t *begin, const uint8_t *end) : pos(begin), end(end) {
+    uint64_t n = 0;
+    if (readVarint(pos, end, n)) count = n;
+}
+
+bool PostingList::next(Posting &posting) {
+    if (count == 0) return false;
+    uint64_t songDelta = 0;
+    uint64_t frame = 0;
+    if (!readVarint(pos, end, songDelta) || !readVarint(pos, end, frame)) {
+        count = 0;
+        return false;
+    }
+    last.songId += uint32_t(songDelta);
+    last.anchorFrame = songDelta == 0 ? last.anchorFrame + uint32_t(frame) : uint32_t(frame);
+    posting = last;
+    count--;
+    return true;
+}
+
+bool FingerprintIndex::open(const std::string &filePath) {
+    *this = FingerprintIndex();
+    if (!file.open(filePath)) {
+        std::cerr << "Failed to open index: " << filePath << "\n";
+        return false;
+    }
+    if (!attach(file.data(), file.size())) {
+        std::cerr << "Not a valid version " << FINGERPRINT_INDEX_VERSION << " index: " << filePath << "\n";
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+bool FingerprintIndex::save(const std::string &filePath) const {
+    if (!header) return false;
+
+    // Written beside the index, synced, then renamed over it in one step, so a crash or power loss mid-write leaves
+    // the old index intact (and a mapping of it, even by this index, keeps reading the old file)
+    std::string temporary = filePath + ".tmp" + std::to_string(::getpid());
+    std::error_code error;
+    if (!writeDurably(temporary, header, size)) {
+        std::cerr << "Failed to write index: " << temporary << "\n";
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, filePath, error);
+    if (error) {
+        std::cerr << "Failed to write index: " << filePath << "\n";
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    syncDirectory(std::filesystem::path(filePath).parent_path());
+    return true;
+}
+
+bool FingerprintIndex::attach(const uint8_t *data, size_t length) {
+    if (length < sizeof(FingerprintIndexHeader)) return false;
+    const FingerprintIndexHeader *h = reinterpret_cast<const FingerprintIndexHeader *>(data);
+    if (std::memcmp(h->magic, FINGERPRINT_INDEX_MAGIC, sizeof(h->magic)) != 0) return false;
+    if (h->version != FINGERPRINT_INDEX_VERSION || h->directoryBits > MAX_DIRECTORY_BITS) return false;
+    if (h->numOfKeys > (uint64_t(1) << 32)) return false;
+
+    if (h->postingBytes > length) return false;
+
+    SectionLayout layout(*h);
+    if (layout.end != length) return false;
+    const uint32_t *d = reinterpret_cast<const uint32_t *>(data + layout.directory);
+    const uint64_t *b = reinterpret_cast<const uint64_t *>(data + layout.bases);
+    const uint32_t *k = reinterpret_cast<const uint32_t *>(data + layout.keys);
+    const uint32_t *o = reinterpret_cast<const uint32_t *>(data + layout.offsets);
+    size_t prefixes = size_t(1) << h->directoryBits;
+    if (d[0] != 0 || d[prefixes] != h->numOfKeys || b[0] != 0 || b[prefixes] != h->postingBytes) return false;
+
+    // Everything lookup trusts, checked once so no lookup can read outside the mapping however corrupt the file:
+    // the directory and bases ascend, every prefix's keys ascend and have that prefix, and every posting list
+    // starts inside its prefix's bytes, after the list before it
+    for (size_t prefix = 0; prefix < prefixes; prefix++) {
+        if (d[prefix + 1] < d[prefix] || b[prefix + 1] < b[prefix]) return false;
+        uint64_t span = b[prefix + 1] - b[prefix];
+        for (size_t i = d[prefix]; i < d[prefix + 1]; i++) {
+            if (directoryPrefix(k[i], h->directoryBits) != prefix || o[i] >= span) return false;
+            bool first = i == d[prefix];
+            if (first && o[i] != 0) return false;
+            if (!first && (k[i] <= k[i - 1] || o[i] <= o[i - 1])) return false;
+        }
+    }
+
+    header = h;
+    directory = d;
+    bases = b;
+    keys = k;
+    offsets = o;
+    postings = data + layout.postings;
+    size = length;
+    return true;
+}
+
+PostingList FingerprintIndex::lookup(uint32_t hash) const {
+    if (!header) return {};
+    uint32_t prefix = directoryPrefix(hash, header->directoryBits);
+    const uint32_t *first = keys + directory[prefix];
+    const uint32_t *last = keys + directory[prefix + 1];
+    const uint32_t *key = std::lower_bound(first, last, hash);
+    if (key == last || *key != hash) return {};
+
+    // A list ends where the next key's starts, or at the next prefix's base for the prefix's last key
+    size_t i = key - keys;
+    const uint8_t *base = postings + bases[prefix];
+    const uint8_t *end = key + 1 == last ? postings + bases[prefix + 1] : base + offsets[i + 1];
+    return {base + offsets[i], end};
+}
+
+void FingerprintIndexBuilder::add(uint32_t songId, const std::vector<fingerprint> &fingerprints) {
+    // Frame order within the song survives build's stable sort, so each posting list comes out fully ordered
+    sorted = fingerprints;
+    sortFingerprints(sorted, sortScratch);
+
+    entries.reserve(entries.size() + sorted.size());
+    for (fingerprint f : sorted) {
+        entries.push_back({uint64_t(fingerprintHash(f)) << 32 | songId, fingerprintFrame(f)});
+    }
+    numOfSongs = std::max<uint64_t>(numOfSongs, uint64_t(songId) + 1);
+}
+
+void FingerprintIndexBuilder::merge(FingerprintIndexBuilder &&other) {
+    // Entries of different songs never share a key, so their relative order is irrelevant to build
+    if (entries.empty()) entries = std::move(other.entries);
+    else entries.insert(entries.end(), other.entries.begin(), other.entries.end());
+    numOfSongs = std::max(numOfSongs, other.numOfSongs);
+    other = FingerprintIndexBuilder();
+}
+
+FingerprintIndex FingerprintIndexBuilder::build() {
+    std::vector<Entry> scratch;
+    radixSort(entries, scratch, [](const Entry &e) { return e.key; }, 64);
+    scratch = {};
+
+    // Encode each run of equal hashes as one posting list
+    std::vector<uint32_t> keys;
+    std::vector<uint64_t> starts;
+    std::vector<uint8_t> postings;
+    for (size_t i = 0; i < entries.size();) {
+        uint32_t hash = uint32_t(entries[i].key >> 32);
+        size_t j = i;
+        while (j < entries.size() && uint32_t(entries[j].key >> 32) == hash) j++;
+
+        keys.push_back(hash);
+        starts.push_back(postings.size());
+        writeVarint(postings, j - i);
+        Posting last = {0, 0};
+        for (; i < j; i++) {
+            uint32_t songId = uint32_t(entries[i].key);
+            uint32_t frame = entries[i].anchorFrame;
+            writeVarint(postings, songId - last.songId);
+            writeVarint(postings, songId == last.songId ? frame - last.anchorFrame : frame);
+            last = {songId, frame};
+        }
+    }
+    FingerprintIndexHeader h = {};
+    std::memcpy(h.magic, FINGERPRINT_INDEX_MAGIC, sizeof(h.magic));
+    h.version = FINGERPRINT_INDEX_VERSION;
+    while (h.directoryBits < MAX_DIRECTORY_BITS && (size_t(2) << h.directoryBits) <= keys.size()) h.directoryBits++;
+    h.numOfKeys = keys.size();
+    h.numOfPostings = entries.size();
+    h.numOfSongs = numOfSongs;
+    h.postingBytes = postings.size();
+
+    // Lay the sections out exactly as they are stored on disk
+    SectionLayout layout(h);
+    FingerprintIndex index;
+    index.image.assign(layout.end, 0);
+    uint8_t *data = index.image.data();
+    std::memcpy(data, &h, sizeof(h));
+
+    uint32_t *directory = reinterpret_cast<uint32_t *>(data + layout.directory);
+    uint64_t *bases = reinterpret_cast<uint64_t *>(data + layout.bases);
+    uint32_t *offsets = reinterpret_cast<uint32_t *>(data + layout.offsets);
+    size_t k = 0;
+    for (size_t prefix = 0; prefix <= (size_t(1) << h.directoryBits); prefix++) {
+        directory[prefix] = uint32_t(k);
+        bases[prefix] = k < keys.size() ? starts[k] : postings.size();
+        while (k < keys.size() && directoryPrefix(keys[k], h.directoryBits) == prefix) {
+            if (starts[k] - bases[prefix] > UINT32_MAX) {
+                std::cerr << "Index too large: the posting lists of hash prefix " << prefix
+                          << " exceed the 4 GiB a 32-bit offset can address\n";
+                *this = FingerprintIndexBuilder();
+                return {};
+            }
+            offsets[k] = uint32_t(starts[k] - bases[prefix]);
+            k++;
+        }
+    }
+    std::copy(keys.begin(), keys.end(), reinterpret_cast<uint32_t *>(data + layout.keys));
+    std::copy(postings.begin(), postings.end(), data + layout.postings);
+    index.attach(data, index.image.size());
+
+    *this = FingerprintIndexBuilder();
+    return index;
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Fingerprint.h"
+#include "MappedFile.h"
+
+#define FINGERPRINT_INDEX_MAGIC "INTUNEIX" // First 8 bytes of an index file
+#define FINGERPRINT_INDEX_VERSION 1 // Bumped whenever the layout below changes
+#define MAX_DIRECTORY_BITS 20 // Top hash bits resolved by the directory (4 MB of directory at most)
+#define SECTION_ALIGNMENT 8 // Bytes; every section starts aligned for its widest field
+
+// One occurrence of a hash: which song, and the anchor frame within it
+struct Posting {
+    uint32_t songId;
+    uint32_t anchorFrame;
+};
+
+/**
+ * The fixed size start of an index file, followed by its sections (each SECTION_ALIGNMENT aligned, in order):
+ *
+ *  directory  (1 << directoryBits) + 1 uint32_t: the first key whose top directoryBits bits are >= each prefix
+ *  bases      (1 << directoryBits) + 1 uint64_t: where the posting lists of each prefix's keys start
+ *  keys       numOfKeys uint32_t: every distinct hash, ascending
+ *  offsets    numOfKeys uint32_t: where each key's posting list starts, relative to its prefix's base
+ *  postings   postingBytes bytes of compressed posting lists (see PostingList)
+ *
+ * @note All fields are little endian, the byte order of every platform this builds for, so a mapping of the
+ * file is used as is.
+ */
+struct FingerprintIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t directoryBits;
+    uint64_t numOfKeys;
+    uint64_t numOfPostings;
+    uint64_t numOfSongs; // One more than the largest songId
+    uint64_t postingBytes;
+    uint64_t reserved[2];
+};
+
+/**
+ * A forward iterator over one hash's postings, decoded on the fly. A list is a varint count followed by its
+ * postings in (songId, anchorFrame) order, each as two varints: the songId delta from the previous posting, then
+ * the anchorFrame delta when the song is unchanged or the anchorFrame itself when it is not.
+ */
+class PostingList {
+public:
+    PostingList() = default;
+    PostingList(const uint8_t *begin, const uint8_t *end);
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    /**
+     * @param posting Receives the next posting.
+     * @return False once the list is exhausted.
+     */
+    bool next(Posting &posting);
+
+private:
+    const uint8_t *pos = nullptr;
+    const uint8_t *end = nullptr;
+    size_t count = 0;
+    Posting last = {0, 0};
+};
+
+/**
+ * Maps fingerprint hashes to the (songId, anchorFrame) postings they occur at, as a sorted CSR (compressed sparse
+ * row) layout: distinct hashes in one sorted array, each with a byte range of delta and varint compressed
+ * postings, plus 8 bytes per distinct hash. Posting size grows with the catalog, since songId deltas within a list
+ * widen as songs are added: about 2 to 4 bytes for a few thousand songs, 4 to 6 at 100k and more. A directory on
+ * the top hash bits narrows every lookup to a short binary search and holds 64-bit byte bases, so per key offsets
+ * fit in 32 bits.
+ *
+ * The in memory layout is the file layout, byte for byte, so an index built in memory is saved with one write
+ * and an index file is opened by mapping it: queries run straight against the mapping with nothing parsed or
+ * copied. Opening reads the directory, keys and offsets once to check they are consistent (so a corrupt file is
+ * rejected rather than read out of bounds); posting pages only fault in as lookups touch them.
+ */
+class FingerprintIndex {
+public:
+    FingerprintIndex() = default;
+
+    /**
+     * Map an index file.
+     *
+     * @param filePath The file written by save.
+     * @return True if and only if the file was mapped and is a valid index of this version.
+     */
+    bool open(const std::string &filePath);
+
+    /**
+     * @param filePath The file to write the index to.
+     * @return True if and only if the whole index was written. It is written to a temporary file, flushed to the
+     * device and renamed over filePath, so filePath always holds a complete index (the old one if writing fails,
+     * the process crashes or the power goes).
+     */
+    bool save(const std::string &filePath) const;
+
+    /**
+     * @param hash A fingerprint hash.
+     * @return Its postings; empty if the hash does not occur.
+     */
+    PostingList lookup(uint32_t hash) const;
+
+    size_t numOfKeys() const { return header ? header->numOfKeys : 0; }
+    size_t numOfPostings() const { return header ? header->numOfPostings : 0; }
+    size_t numOfSongs() const { return header ? header->numOfSongs : 0; }
+    size_t sizeInBytes() const { return size; }
+    operator bool() const { return header != nullptr; }
+
+private:
+    friend class FingerprintIndexBuilder;
+
+    // Backing bytes: an owned image (built in memory) or a mapping (opened); the pointers below point into one
+    std::vector<uint8_t> image;
+    MappedFile file;
+    size_t size = 0;
+
+    const FingerprintIndexHeader *header = nullptr;
+    const uint32_t *directory = nullptr;
+    const uint64_t *bases = nullptr;
+    const uint32_t *keys = nullptr;
+    const uint32_t *offsets = nullptr;
+    const uint8_t *postings = nullptr;
+
+    bool attach(const uint8_t *data, size_t length);
+};
+
+/**
+ * Collects the fingerprints of many songs and lays them out as a FingerprintIndex.
+ */
+class FingerprintIndexBuilder {
+public:
+    /**
+     * Add all fingerprints of one song. Each song should be added once.
+     *
+     * @param songId The song's id; ids need not be dense or in order, but numOfSongs is the largest id + 1.
+     * @param fingerprints The song's fingerprints, in any order.
+     */
+    void add(uint32_t songId, const std::vector<fingerprint> &fingerprints);
+
+    // Move all of another builder's songs into this one, e.g. to combine builders filled by separate threads
+    void merge(FingerprintIndexBuilder &&other);
+
+    size_t numOfPostings() const { return entries.size(); }
+
+    // Build the index, leaving the builder empty. Fails (printing why and returning an empty index) if a directory
+    // prefix's posting lists outgrow the 4 GiB its 32-bit offsets address.
+    FingerprintIndex build();
+
+private:
+    struct Entry {
+        uint64_t key; // hash << 32 | songId
+        uint32_t anchorFrame;
+    };
+    std::vector<Entry> entries;
+    std::vector<fingerprint> sorted; // add's copy of a song's fingerprints, kept so adding songs reuses its buffer
+    std::vector<fingerprint> sortScratch; // Likewise sortFingerprints' scratch
+    uint64_t numOfSongs = 0;
+};
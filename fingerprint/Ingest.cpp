@@ -0,0 +1,157 @@
+#include "Ingest.h"
+#include "Metrics.h"
+#include "Peaks.h"
+#include "StreamingStft.h"
+#include "ThreadPool.h"
+#include "Wav.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// Everything a worker reuses from one file to the next. The STFT (window tables, FFT scratch, resampler, ring) and
+// peak extractor are made for the worker's first file and reset for each one after it.
+struct IngestWorkspace {
+    std::vector<float> block;
+    std::unique_ptr<PeakExtractor> extractor;
+    std::unique_ptr<StreamingStft<>> stft;
+    std::vector<Peak> peaks;
+    std::vector<fingerprint> fingerprints;
+    FingerprintIndexBuilder builder;
+    IngestStats stats;
+};
+
+bool isWav(const std::filesystem::path &path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".wav";
+}
+
+void ingestFile(const std::string &path, uint32_t songId, const FingerprintParams &params,
+                const FingerprintCache &cache, IngestWorkspace &ws) {
+    MappedWavFile file(path);
+    if (!file || file.header.sampleRate == 0) {
+        ws.stats.failed++;
+        return;
+    }
+    INTUNE_METRICS_LABEL(pcmFormat(file.header.audioFormat, file.header.bitsPerSample), file.header.sampleRate);
+    double audioSeconds = double(file.numOfFrames()) / file.header.sampleRate;
+
+    CacheKey key;
+    if (cache) {
+        key = cacheKey(file, params);
+        CacheEntry entry;
+        if (cache.lookup(key, entry)) {
+            ws.fingerprints.assign(entry.fingerprints(), entry.fingerprints() + entry.numOfFingerprints());
+            ws.builder.add(songId, ws.fingerprints);
+            ws.stats.files++;
+            ws.stats.cached++;
+            ws.stats.audioSeconds += audioSeconds;
+            return;
+        }
+    }
+
+    if (!ws.stft) {
+        ws.extractor = std::make_unique<PeakExtractor>(FRAME_SIZE / 2 + 1, params.peaks);
+        PeakExtractor &extractor = *ws.extractor;
+        ws.stft = std::make_unique<StreamingStft<>>(
+            file.header.sampleRate, [&extractor](size_t, const std::complex<sample_t> *bins) { extractor.push(bins); });
+    } else {
+        ws.extractor->reset();
+        ws.stft->reset(file.header.sampleRate);
+    }
+
+    ws.block.resize(INGEST_BLOCK_FRAMES);
+    for (size_t offset = 0; offset < file.numOfFrames(); offset += INGEST_BLOCK_FRAMES) {
+        size_t read = file.readFrames(offset, INGEST_BLOCK_FRAMES, ws.block.data());
+        ws.stft->push(ws.block.data(), read);
+    }
+    ws.stft->flush();
+    ws.extractor->flush();
+
+    ws.extractor->takePeaks(ws.peaks);
+    generateFingerprints(ws.peaks, ws.fingerprints, params);
+    if (cache) cache.store(key, ws.peaks, ws.fingerprints, audioSeconds);
+    ws.builder.add(songId, ws.fingerprints);
+    ws.stats.files++;
+    ws.stats.audioSeconds += audioSeconds;
+}
+
+} // namespace
+
+std::vector<std::string> listWavFiles(const std::string &path) {
+    std::vector<std::string> files;
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) {
+        for (auto it = std::filesystem::recursive_directory_iterator(path, error);
+             it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if (error) break;
+            if (it->is_regular_file(error) && isWav(it->path())) files.push_back(it->path().string());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::ifstream list(path);
+    if (!list) {
+        std::cerr << "Failed to open file list: " << path << "\n";
+        return files;
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) files.push_back(line);
+    }
+    return files;
+}
+
+IngestStats ingest(const std::vector<std::string> &files, FingerprintIndexBuilder &builder,
+                   const IngestParams &params) {
+    auto start = std::chrono::steady_clock::now();
+    // threads counts the caller, which ingests files itself whenever the queue is full rather than sleeping
+    ThreadPool pool(params.threads > 0 ? params.threads - 1 : ThreadPool::defaultThreads());
+    std::vector<IngestWorkspace> workspaces(pool.numOfWorkers());
+    IngestWorkspace &callerWorkspace = workspaces.back();
+    FingerprintCache cache(params.cacheDirectory);
+
+    // Backpressure: never more than maxInFlight files queued or running on the pool threads
+    size_t maxInFlight = params.maxInFlight > 0 ? params.maxInFlight : INGEST_TASKS_PER_THREAD * pool.numOfWorkers();
+    std::mutex mutex;
+    size_t inFlight = 0;
+
+    for (size_t i = 0; i < files.size(); i++) {
+        bool full;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            full = inFlight >= maxInFlight;
+            if (!full) inFlight++;
+        }
+        if (full) {
+            ingestFile(files[i], uint32_t(i), params.fingerprints, cache, callerWorkspace);
+            continue;
+        }
+        pool.submit([&, i](size_t worker) {
+            ingestFile(files[i], uint32_t(i), params.fingerprints, cache, workspaces[worker]);
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight--;
+        });
+    }
+    pool.wait();
+
+    IngestStats stats;
+    for (IngestWorkspace &ws : workspaces) {
+        builder.merge(std::move(ws.builder));
+        stats.files += ws.stats.files;
+        stats.cached += ws.stats.cached;
+        stats.failed += ws.stats.failed;
+        stats.audioSeconds += ws.stats.audioSeconds;
+    }
+    stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
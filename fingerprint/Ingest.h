@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Fingerprint.h"
+#include "FingerprintCache.h"
+#include "FingerprintIndex.h"
+
+#define INGEST_BLOCK_FRAMES (1 << 16) // Sample frames decoded per block
+#define INGEST_TASKS_PER_THREAD 4 // Files queued or running per thread before the caller takes one (backpressure)
+
+struct IngestParams {
+    size_t threads = 0; // Threads working, the caller included; 0 for one per hardware thread
+    size_t maxInFlight = 0; // Files queued or running at once; 0 for INGEST_TASKS_PER_THREAD per thread
+    FingerprintParams fingerprints;
+    std::string cacheDirectory; // A FingerprintCache of every file's fingerprints; empty to always recompute
+};
+
+struct IngestStats {
+    size_t files = 0; // Files fingerprinted
+    size_t cached = 0; // Of those, files whose fingerprints were read from the cache
+    size_t failed = 0; // Files that could not be read
+    double audioSeconds = 0.0;
+    double wallSeconds = 0.0;
+
+    double filesPerSecond() const { return wallSeconds > 0 ? files / wallSeconds : 0.0; }
+    double audioHoursPerSecond() const { return wallSeconds > 0 ? audioSeconds / 3600.0 / wallSeconds : 0.0; }
+};
+
+/**
+ * Collect the .wav files to ingest.
+ *
+ * @param path A directory (searched recursively for .wav files) or a text file listing one path per line.
+ * @return The paths, sorted when found in a directory so song ids are reproducible.
+ */
+std::vector<std::string> listWavFiles(const std::string &path);
+
+/**
+ * Fingerprint many .wav files on a work stealing ThreadPool. Each file is one task that streams it through
+ * decode, resampling, STFT, peak extraction and hashing block by block (StreamingStft into PeakExtractor), so a
+ * task holds about one decode block of audio at a time whatever the file's length. While maxInFlight files are
+ * queued or running, the caller fingerprints the next file itself instead of queueing it, which bounds memory
+ * however many files there are and keeps the caller working rather than sleeping beside the pool threads.
+ *
+ * Every worker keeps its decode buffer, StreamingStft, PeakExtractor, peak and fingerprint buffers and
+ * FingerprintIndexBuilder across files (resetting rather than rebuilding them), so threads share nothing while they
+ * work and window tables are built once per worker, not once per file; the builders are merged once all files
+ * are done.
+ *
+ * With a cacheDirectory, each file's data chunk is hashed first and unchanged files (same audio, format and
+ * parameters, wherever they now live) take their fingerprints from the cache without being decoded; the rest are
+ * fingerprinted as usual and added to it. Nightly rebuilds of a mostly unchanged catalog then cost a hash a file.
+ *
+ * @param files The files; file i gets songId i.
+ * @param builder Receives every file's fingerprints.
+ * @param params Threads, backpressure and fingerprinting.
+ * @return Counts and throughput.
+ */
+IngestStats ingest(const std::vector<std::string> &files, FingerprintIndexBuilder &builder,
+                   const IngestParams &params = {});
@@ -0,0 +1,150 @@
+#include "Matcher.h"
+#include <algorithm>
+
+namespace {
+
+uint64_t voteKey(uint32_t songId, int32_t offset) {
+    return uint64_t(songId) << 32 | uint32_t(offset);
+}
+
+} // namespace
+
+// Open addressing (linear probing) map from a (songId, offset) key to its votes. The slots in use are listed, so
+// clearing and walking cost the number of keys rather than the capacity.
+struct Matcher::VoteMap {
+    static constexpr uint64_t EMPTY = ~uint64_t(0);
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> votes;
+    std::vector<uint32_t> used; // Occupied slots, in insertion order
+    size_t mask = 0;
+
+    VoteMap() { resize(1 << 12); }
+
+    void add(uint64_t key, uint32_t count) {
+        if (2 * (used.size() + 1) > keys.size()) resize(2 * keys.size());
+        size_t slot = (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+        while (keys[slot] != key) {
+            if (keys[slot] == EMPTY) {
+                keys[slot] = key;
+                votes[slot] = 0;
+                used.push_back(uint32_t(slot));
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        votes[slot] += count;
+    }
+
+    void clear() {
+        for (uint32_t slot : used) keys[slot] = EMPTY;
+        used.clear();
+    }
+
+    void resize(size_t capacity) {
+        std::vector<uint64_t> oldKeys(capacity, EMPTY);
+        std::vector<uint32_t> oldVotes(capacity);
+        std::vector<uint32_t> oldUsed;
+        oldKeys.swap(keys);
+        oldVotes.swap(votes);
+        oldUsed.swap(used);
+        mask = capacity - 1;
+        for (uint32_t slot : oldUsed) add(oldKeys[slot], oldVotes[slot]);
+    }
+};
+
+Matcher::Matcher(const FingerprintIndex &index, ThreadPool *pool)
+    : index(index), pool(pool), workerVotes(pool ? pool->numOfWorkers() : 1), totals(std::make_unique<VoteMap>()) {}
+
+Matcher::~Matcher() = default;
+
+std::vector<MatchCandidate> Matcher::match(const std::vector<fingerprint> &query, const MatchParams &params) {
+    lookedUp = 0;
+    totals->clear();
+    if (query.empty()) return {};
+
+    // Sorting by hash makes each shard a hash range and puts repeats of a hash next to each other, so every
+    // distinct hash is looked up once per shard
+    sorted = query;
+    sortFingerprints(sorted, scratch);
+
+    size_t n = sorted.size();
+    size_t shardsPerRound = workerVotes.size() * MATCH_SHARDS_PER_WORKER;
+    size_t shardSize = std::max<size_t>(1, (n + shardsPerRound * MATCH_ROUNDS - 1) / (shardsPerRound * MATCH_ROUNDS));
+    size_t roundSize = shardSize * shardsPerRound;
+
+    auto lookUpShard = [&](size_t begin, size_t end, VoteMap &votes) {
+        for (size_t i = begin; i < end;) {
+            uint32_t hash = fingerprintHash(sorted[i]);
+            size_t j = i;
+            while (j < end && fingerprintHash(sorted[j]) == hash) j++;
+
+            PostingList postings = index.lookup(hash);
+            if (params.maxPostings == 0 || postings.size() <= params.maxPostings) {
+                Posting posting;
+                while (postings.next(posting)) {
+                    for (size_t q = i; q < j; q++) {
+                        int32_t offset = int32_t(posting.anchorFrame - fingerprintFrame(sorted[q]));
+                        votes.add(voteKey(posting.songId, offset), 1);
+                    }
+                }
+            }
+            i = j;
+        }
+    };
+
+    for (size_t roundStart = 0; roundStart < n; roundStart += roundSize) {
+        size_t roundEnd = std::min(n, roundStart + roundSize);
+        size_t numOfShards = (roundEnd - roundStart + shardSize - 1) / shardSize;
+        auto task = [&](size_t shard, size_t worker) {
+            size_t begin = roundStart + shard * shardSize;
+            lookUpShard(begin, std::min(roundEnd, begin + shardSize), workerVotes[worker]);
+        };
+        if (pool) pool->parallelFor(numOfShards, task);
+        else for (size_t shard = 0; shard < numOfShards; shard++) task(shard, 0);
+
+        for (VoteMap &votes : workerVotes) {
+            for (uint32_t slot : votes.used) totals->add(votes.keys[slot], votes.votes[slot]);
+            votes.clear();
+        }
+        lookedUp = roundEnd;
+
+        // Each hash still to be looked up adds at most one vote to any one (song, offset), so a lead bigger than
+        // the hashes left is final
+        uint32_t leader = 0;
+        uint32_t runnerUp = 0;
+        for (uint32_t slot : totals->used) {
+            uint32_t v = totals->votes[slot];
+            if (v > leader) {
+                runnerUp = leader;
+                leader = v;
+            } else if (v > runnerUp) {
+                runnerUp = v;
+            }
+        }
+        uint32_t margin = leader - runnerUp;
+        bool decided = margin > n - lookedUp || (params.earlyStopMargin > 0 && margin >= params.earlyStopMargin);
+        if (leader >= params.minVotes && decided) break;
+    }
+
+    // Best offset of each song, most votes first
+    std::vector<MatchCandidate> ranked;
+    for (uint32_t slot : totals->used) {
+        uint32_t v = totals->votes[slot];
+        if (v < params.minVotes) continue;
+        uint64_t key = totals->keys[slot];
+        ranked.push_back({uint32_t(key >> 32), int32_t(uint32_t(key)), v, float(v) / float(n)});
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const MatchCandidate &a, const MatchCandidate &b) {
+        return a.votes != b.votes ? a.votes > b.votes : a.songId < b.songId;
+    });
+
+    std::vector<MatchCandidate> candidates;
+    for (const MatchCandidate &c : ranked) {
+        if (candidates.size() == params.maxCandidates) break;
+        bool seen = std::any_of(candidates.begin(), candidates.end(),
+                                [&](const MatchCandidate &other) { return other.songId == c.songId; });
+        if (!seen) candidates.push_back(c);
+    }
+    return candidates;
+}
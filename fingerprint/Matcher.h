@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "FingerprintIndex.h"
+#include "ThreadPool.h"
+
+#define MATCH_MAX_CANDIDATES 5 // Songs returned per query
+#define MATCH_MIN_VOTES 5 // Fewer aligned hashes than this is treated as chance
+#define MATCH_EARLY_STOP_MARGIN 50 // Votes the leader must be ahead by to stop before every hash is looked up
+#define MATCH_MAX_POSTINGS 20000 // Hashes more common than this say little about which song it is, so are skipped
+#define MATCH_SHARDS_PER_WORKER 4 // Hash shards per worker and round (smaller shards balance better)
+#define MATCH_ROUNDS 8 // Times the votes are tallied, i.e. chances to stop early
+
+// A song the query may be from
+struct MatchCandidate {
+    uint32_t songId;
+    int32_t offset; // Frames from the start of the song to the start of the query
+    uint32_t votes; // Query hashes that occur in the song at that offset
+    float confidence; // votes as a fraction of the query's fingerprints
+};
+
+struct MatchParams {
+    size_t maxCandidates = MATCH_MAX_CANDIDATES;
+    uint32_t minVotes = MATCH_MIN_VOTES;
+    uint32_t earlyStopMargin = MATCH_EARLY_STOP_MARGIN; // 0 to only stop when the leader can no longer be caught
+    size_t maxPostings = MATCH_MAX_POSTINGS; // 0 for no limit
+};
+
+/**
+ * Matches query fingerprints against a FingerprintIndex by offset voting: a query hash at frame q that occurs
+ * in song s at anchor frame a votes for (s, a - q), and a true match piles its votes onto one offset while chance
+ * hits scatter.
+ *
+ * The query is sorted by hash and cut into shards, which the workers of a ThreadPool look up in parallel, each
+ * counting into its own open addressing hash map so no votes are shared between threads until they are merged.
+ * Shards are taken in rounds; after each round the votes are merged and the match stops early once the leader is
+ * earlyStopMargin votes ahead of every other (song, offset), or further ahead than the hashes left could change.
+ *
+ * @note Vote maps are kept between queries to avoid reallocating them, so a Matcher runs one query at a time.
+ */
+class Matcher {
+public:
+    /**
+     * @param index The index to match against; must outlive the matcher.
+     * @param pool The threads to match on; nullptr matches on the calling thread only.
+     */
+    explicit Matcher(const FingerprintIndex &index, ThreadPool *pool = nullptr);
+    ~Matcher();
+
+    /**
+     * @param query The fingerprints of the clip, in any order.
+     * @param params Candidate count, vote thresholds and early stopping.
+     * @return Up to maxCandidates songs with at least minVotes votes (at their best offset), most votes first.
+     */
+    std::vector<MatchCandidate> match(const std::vector<fingerprint> &query, const MatchParams &params = {});
+
+    // Hashes looked up by the last match; fewer than its query size when it stopped early
+    size_t hashesLookedUp() const { return lookedUp; }
+
+private:
+    struct VoteMap;
+
+    const FingerprintIndex &index;
+    ThreadPool *pool;
+    std::vector<VoteMap> workerVotes; // One per worker
+    std::unique_ptr<VoteMap> totals; // Votes merged from every worker
+    std::vector<fingerprint> sorted;
+    std::vector<fingerprint> scratch;
+    size_t lookedUp = 0;
+};
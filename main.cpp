@@ -1,18 +1,142 @@
 #include "signal_processor/Wav.h"
+#include "fingerprint/Fingerprint.h"
+#include "fingerprint/FingerprintCache.h"
+#include "fingerprint/Ingest.h"
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include "signal_processor/Metrics.h"
+#include "signal_processor/Peaks.h"
+#include "signal_processor/Render.h"
 #include "signal_processor/Spectrogram.h"
+#include "signal_processor/StreamingStft.h"
+
+/**
+ * Fingerprint a catalog into an index file, plus a <index>.songs file naming song i on line i.
+ *
+ * @param source A directory of .wav files or a text file listing them.
+ * @param indexPath Where to save the index.
+ * @param threads Worker threads; 0 for one per hardware thread.
+ * @param cacheDirectory A FingerprintCache to take unchanged files' fingerprints from and add the rest to; empty for
+ * none.
+ * @return The process exit code.
+ */
+int ingestCatalog(const std::string &source, const std::string &indexPath, size_t threads,
+                  const std::string &cacheDirectory) {
+    std::vector<std::string> files = listWavFiles(source);
+    if (files.empty()) {
+        std::cerr << "No .wav files found in: " << source << "\n";
+        return 1;
+    }
+
+    FingerprintIndexBuilder builder;
+    IngestParams params;
+    params.threads = threads;
+    params.cacheDirectory = cacheDirectory;
+    IngestStats stats = ingest(files, builder, params);
+    std::cerr << "Ingested " << stats.files << " files (" << stats.cached << " cached, " << stats.failed << " failed, "
+              << stats.audioSeconds / 3600.0 << " hours of audio) in " << stats.wallSeconds << " s: "
+              << stats.filesPerSecond() << " files/s, " << stats.audioHoursPerSecond() << " audio hours/s\n";
+
+    FingerprintIndex index = builder.build();
+    if (!index.save(indexPath)) return 1;
+    std::ofstream songs(indexPath + ".songs");
+    for (const std::string &file : files) songs << file << "\n";
+    std::cerr << "Index: " << index.numOfKeys() << " hashes, " << index.numOfPostings() << " postings, "
+              << index.sizeInBytes() << " bytes\n";
+    return 0;
+}
+
+/**
+ * @param text A command line argument.
+ * @param count Receives the value if text is entirely a decimal count.
+ * @return True if and only if text is a decimal count (no sign, spaces or trailing characters).
+ */
+bool parseCount(const std::string &text, size_t &count) {
+    const char *end = text.data() + text.size();
+    auto [last, error] = std::from_chars(text.data(), end, count);
+    return !text.empty() && error == std::errc() && last == end;
+}
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        std::cout << "argc != 2";
+    // Per stage timings (see signal_processor/Metrics.h) are written on exit when asked for, as JSON or as
+    // Prometheus text if the file name ends in .prom
+    if (const char *metricsPath = std::getenv("INTUNE_METRICS_FILE")) writeMetricsAtExit(metricsPath);
+
+    bool usage = argc < 2;
+    if (!usage && std::string(argv[1]) == "--ingest") {
+        size_t threads = 0;
+        std::string cacheDirectory;
+        usage = argc < 4;
+        for (int i = 4; i < argc && !usage; i++) {
+            std::string arg = argv[i];
+            if (arg == "--cache" && i + 1 < argc) cacheDirectory = argv[++i];
+            else usage = !parseCount(arg, threads);
+        }
+        if (!usage) return ingestCatalog(argv[2], argv[3], threads, cacheDirectory);
+    }
+
+    // Headless rendering: --render writes one image and --tiles a zoomable tile pyramid, instead of opening a window
+    std::string imagePath;
+    std::string tilesPath;
+    std::string cacheDirectory;
+    RenderParams params;
+    for (int i = 2; i < argc && !usage; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--render" && hasValue) imagePath = argv[++i];
+        else if (arg == "--tiles" && hasValue) tilesPath = argv[++i];
+        else if (arg == "--cache" && hasValue) cacheDirectory = argv[++i];
+        else if (arg == "--mean") params.pooling = Pooling::Mean;
+        else usage = true;
+    }
+    if (usage) {
+        std::cout << "Usage: " << argv[0] << " <file.wav> [--render <image.png|.ppm>] [--tiles <directory>] [--mean]"
+                  << " [--cache <directory>] | --ingest <directory|list.txt> <index> [threads] [--cache <directory>]\n";
         return 1;
     }
     
-    WavFile file = WavFile(argv[1]);
+    // Decode straight out of a memory mapping, block by block, rather than loading the whole file
+    MappedWavFile file(argv[1]);
     if (!file) return 1;
 
-    auto signal = file.extractSignal();
-    spectrogram s = Spectrogram(signal, file.header.sampleRate);
-    // transpose(s);
-    visualize(s);
-}
\ No newline at end of file
+    // With a cache, an unchanged file's peaks, fingerprints and spectrogram (kept in decibels) come from its entry
+    // rather than another decode and STFT
+    FingerprintCache cache(cacheDirectory);
+    CacheKey key;
+    CacheEntry entry;
+    if (cache) key = cacheKey(file);
+
+    spectrogram s;
+    SpectrogramMatrix<LogMagnitudeStorage> cached;
+    std::vector<Peak> peaks;
+    std::vector<fingerprint> fingerprints;
+    if (cache && cache.lookup(key, entry) && entry.hasSpectrogram()) {
+        entry.copyPeaks(peaks);
+        fingerprints.assign(entry.fingerprints(), entry.fingerprints() + entry.numOfFingerprints());
+        cached = entry.spectrogram();
+        params.decibels = true;
+    } else {
+        s = Spectrogram(file);
+        peaks = extractPeaks(s.view());
+        generateFingerprints(peaks, fingerprints);
+        if (cache) cache.store(key, peaks, fingerprints, double(file.numOfFrames()) / file.header.sampleRate, &s);
+    }
+    std::cerr << "Peaks: " << peaks.size() << ", Fingerprints: " << fingerprints.size() << "\n";
+
+    // [frequency][time] without copying
+    SpectrogramView<const float> plot = (params.decibels ? cached.view() : s.view()).transposed();
+    if (!imagePath.empty() && !writeImage(renderSpectrogram(plot, params), imagePath)) return 1;
+    if (!tilesPath.empty() && !renderTilePyramid(plot, tilesPath, params, double(FINGERPRINT_SAMPLE_RATE) / HOP_SIZE)) {
+        return 1;
+    }
+    if (!imagePath.empty() || !tilesPath.empty()) return 0;
+#if defined(INTUNE_HAVE_OPENCV)
+    visualize(plot, params.decibels);
+#else
+    std::cerr << "Built without OpenCV, so there is no viewer window; use --render or --tiles.\n";
+    return 1;
+#endif
+}
@@ -0,0 +1,77 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local size_t threadCount = 0;
+std::atomic<size_t> totalCount{0};
+
+} // namespace
+
+#if defined(INTUNE_COUNT_ALLOCATIONS)
+
+namespace {
+
+void *countedAlloc(size_t size, size_t alignment) {
+    threadCount++;
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    void *p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) p = std::malloc(size);
+    else if (posix_memalign(&p, alignment, size) != 0) p = nullptr;
+    return p;
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+    if (void *p = countedAlloc(size, 0)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) {
+    if (void *p = countedAlloc(size, 0)) return p;
+    throw std::bad_alloc();
+}
+void *operator new(size_t size, std::align_val_t alignment) {
+    if (void *p = countedAlloc(size, size_t(alignment))) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+    if (void *p = countedAlloc(size, size_t(alignment))) return p;
+    throw std::bad_alloc();
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size, 0); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size, 0); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+bool allocationCountingEnabled() {
+    return true;
+}
+
+#else
+
+bool allocationCountingEnabled() {
+    return false;
+}
+
+#endif
+
+size_t threadAllocations() {
+    return threadCount;
+}
+
+size_t totalAllocations() {
+    return totalCount.load(std::memory_order_relaxed);
+}
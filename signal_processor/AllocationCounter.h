@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * Heap allocation counts, for checking that hot loops do not allocate, e.g.
+ *
+ *     size_t before = threadAllocations();
+ *     stft.push(samples, count);
+ *     assert(threadAllocations() == before);
+ *
+ * as the allocations check of intune_check (tests/AllocationCheck.cpp) does for the STFT.
+ *
+ * Counting replaces the global operator new, so it is only compiled in when INTUNE_COUNT_ALLOCATIONS is defined
+ * (the CMake option of the same name); otherwise every count stays 0.
+ */
+
+// True if and only if this build counts allocations
+bool allocationCountingEnabled();
+
+// Allocations made through operator new by the calling thread since it started
+size_t threadAllocations();
+
+// Allocations made through operator new by every thread since the program started
+size_t totalAllocations();
@@ -0,0 +1,37 @@
+#include "CpuFeatures.h"
+#include <atomic>
+
+namespace {
+
+SimdLevel detect() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::Sse2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+std::atomic<int> forcedLevel{-1};
+
+} // namespace
+
+SimdLevel simdLevel() {
+    static const SimdLevel detected = detect();
+    int forced = forcedLevel.load(std::memory_order_relaxed);
+    if (forced >= 0 && forced < int(detected)) return SimdLevel(forced);
+    return detected;
+}
+
+void forceSimdLevel(SimdLevel level) {
+    forcedLevel.store(int(level), std::memory_order_relaxed);
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx2: return "avx2";
+        case SimdLevel::Sse2: return "sse2";
+        case SimdLevel::Scalar:
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Instruction set levels that hand vectorized kernels are built for, from least to most capable
+enum class SimdLevel {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+/**
+ * Detect the best instruction set the running CPU supports. Kernels for every level are compiled into
+ * the binary, and this is checked once at runtime to pick between them, so one build runs everywhere.
+ *
+ * @return The detected SIMD level, or the level passed to forceSimdLevel if one was set.
+ */
+SimdLevel simdLevel();
+
+/**
+ * Cap the SIMD level returned by simdLevel, e.g. to compare kernels against the scalar fallback.
+ *
+ * @param level The highest level kernels may use. Levels above what the CPU supports are ignored.
+ */
+void forceSimdLevel(SimdLevel level);
+
+const char* simdLevelName(SimdLevel level);
@@ -1,46 +1,126 @@
 #include "Fft.h"
+#include <memory>
+#include <stdexcept>
 
-complex_vector FFT(std::vector<double> p) {
-    // Transform polynomial p to be its complex counterpart (necessary for FFT algorithm)
-    complex_vector complexP;
-    for (double &coeff : p) {
-        complexP.push_back({coeff, 0.0});
+FftPlan::FftPlan(size_t n) : n(n) {
+    if (n < 2 || (n & (n - 1)) != 0) throw std::invalid_argument("FftPlan size must be a power of two >= 2");
+
+    // Roots of unity w^k = e^(2*pi*i*k/n). A transform of size m < n uses every (n/m)th entry.
+    twiddles.resize(n / 2);
+    for (size_t k = 0; k < n / 2; k++) {
+        twiddles[k] = std::polar(1.0, 2 * M_PI * k / n);
     }
 
-    // Recursively compute FFT
-    return recFFT(complexP);
+    // Bit reversal over log2(n) bits. Note rev(2k) over log2(n) bits == rev(k) over log2(n/2) bits, so the
+    // half size permutation used by forwardReal is bitReversal[2k].
+    size_t bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+    bitReversal.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        uint32_t r = 0;
+        for (size_t b = 0; b < bits; b++) {
+            if (k & (size_t(1) << b)) r |= uint32_t(1) << (bits - 1 - b);
+        }
+        bitReversal[k] = r;
+    }
 }
 
-void splitPolynomialByEvenOddDegrees(complex_vector &p, complex_vector &pEven, complex_vector &pOdd) {
-    for (int i = 0; i < p.size() / 2; i++) {
-        pEven.push_back(p[i * 2]);
-        pOdd.push_back(p[i * 2 + 1]);
+void FftPlan::transform(complex_number *data, size_t m) const {
+    // data holds m points already in bit reversed order. Each pass merges adjacent sub transforms of
+    // length len into one of length 4 * len (radix-4), which is two radix-2 passes for one trip through memory.
+    size_t stride = n / m; // Twiddle table step for a transform of size m
+    size_t len = 1;
+
+    size_t log2m = 0;
+    while ((size_t(1) << log2m) < m) log2m++;
+    if (log2m % 2 == 1) {
+        // Odd number of radix-2 stages; peel one off so the rest pair up. Twiddles are all 1 at len 1.
+        for (size_t i = 0; i < m; i += 2) {
+            complex_number a = data[i];
+            complex_number b = data[i + 1];
+            data[i] = a + b;
+            data[i + 1] = a - b;
+        }
+        len = 2;
+    }
+
+    for (; len < m; len *= 4) {
+        size_t twStep = stride * (m / (4 * len)); // w_{4len}^j == twiddles[j * twStep]
+        for (size_t block = 0; block < m; block += 4 * len) {
+            complex_number *a0 = data + block;
+            complex_number *a1 = a0 + len;
+            complex_number *a2 = a1 + len;
+            complex_number *a3 = a2 + len;
+            for (size_t j = 0; j < len; j++) {
+                complex_number w1 = twiddles[2 * j * twStep]; // w_{2len}^j (first radix-2 stage)
+                complex_number w2 = twiddles[j * twStep]; // w_{4len}^j (second radix-2 stage)
+
+                complex_number t1 = w1 * a1[j];
+                complex_number t3 = w1 * a3[j];
+                complex_number b0 = a0[j] + t1;
+                complex_number b1 = a0[j] - t1;
+                complex_number c0 = w2 * (a2[j] + t3);
+                complex_number c1 = w2 * (a2[j] - t3);
+                c1 = {-c1.imag(), c1.real()}; // Multiply by w_4 = i
+
+                a0[j] = b0 + c0;
+                a2[j] = b0 - c0;
+                a1[j] = b1 + c1;
+                a3[j] = b1 - c1;
+            }
+        }
     }
 }
 
-complex_vector recFFT(complex_vector p) {
-    size_t n = p.size();
+void FftPlan::forward(const complex_number *in, complex_number *out) const {
+    if (in == out) {
+        for (size_t k = 0; k < n; k++) {
+            if (k < bitReversal[k]) std::swap(out[k], out[bitReversal[k]]);
+        }
+    } else {
+        for (size_t k = 0; k < n; k++) out[k] = in[bitReversal[k]];
+    }
+    transform(out, n);
+}
 
-    // Only have one element meaning p is a degree 0 polynomial (constant)
-    if (n <= 1) return p;
-    
-    // Split polynomial into even and odd degree terms
-    complex_vector pEven;
-    complex_vector pOdd;
-    splitPolynomialByEvenOddDegrees(p, pEven, pOdd);
+void FftPlan::forwardReal(const double *in, complex_number *out) const {
+    size_t h = n / 2;
 
-    // Recurse down, further splitting p
-    complex_vector yEven = recFFT(pEven);
-    complex_vector yOdd = recFFT(pOdd);
+    // Pack z[m] = x[2m] + i * x[2m + 1] straight into bit reversed order and transform as n/2 complex points
+    for (size_t k = 0; k < h; k++) {
+        size_t m = bitReversal[2 * k];
+        out[k] = {in[2 * m], in[2 * m + 1]};
+    }
+    transform(out, h);
 
-    // Build up the value representation of p using pEven and pOdd
-    complex_vector y(n);
-    for (int j = 0; j < n / 2; j++) {
-        // w is defined as jth root of unity 
-        complex_number w = {cos(2 * M_PI * j / n), sin(2 * M_PI * j / n)};
-        y[j] = yEven[j] + w * yOdd[j];
-        y[j + n / 2] = yEven[j] - w * yOdd[j];
+    // Split Z into the spectra of the even (E) and odd (O) samples, then X[k] = E[k] + w^k * O[k]. Bins k and
+    // h - k read each other, so both are produced together in place.
+    complex_number z0 = out[0];
+    out[0] = {z0.real() + z0.imag(), 0.0};
+    out[h] = {z0.real() - z0.imag(), 0.0};
+    for (size_t k = 1; k <= h / 2; k++) {
+        complex_number zk = out[k];
+        complex_number zhk = std::conj(out[h - k]);
+        complex_number e = 0.5 * (zk + zhk);
+        complex_number d = 0.5 * (zk - zhk);
+        complex_number o = {d.imag(), -d.real()}; // d / i
+        complex_number wo = twiddles[k] * o;
+        out[k] = e + wo;
+        out[h - k] = std::conj(e - wo);
     }
+}
 
+complex_vector FFT(const std::vector<double> &p) {
+    size_t n = p.size();
+    if (n <= 1) return complex_vector(p.begin(), p.end());
+
+    // Plans are immutable once built, so caching the last one per thread makes repeat calls cheap
+    thread_local std::unique_ptr<FftPlan> plan;
+    if (!plan || plan->size() != n) plan = std::make_unique<FftPlan>(n);
+
+    // Rebuild the redundant upper half from conjugate symmetry: X[n - k] = conj(X[k])
+    complex_vector y(n);
+    plan->forwardReal(p.data(), y.data());
+    for (size_t k = n / 2 + 1; k < n; k++) y[k] = std::conj(y[n - k]);
     return y;
-}
\ No newline at end of file
+}
@@ -1,36 +1,73 @@
+#pragma once
 #include <vector>
 #include <complex>
 #include <cmath>
+#include <cstdint>
 
 using complex_number = std::complex<double>;
 using complex_vector = std::vector<std::complex<double>>;
 
-/**
- * Fast Fourier Transform (FFT) translates the coefficient representation of a polynomial into
- * its respective value representation.
- * 
- * @param p The coefficient representation of a polynomial p. 
- * @return The value representation of polynomial p.
- * 
- * @note In the context of signals, p is a signal as a amplitude/time vector in its time domain
- * and performing an FFT on p will result in the signal in it's frequency domain.
- */
-complex_vector FFT(std::vector<double> p);
+// The precision the signal pipeline (decode, resample, window, FFT, spectrogram) runs in unless asked otherwise.
+// Samples start out as 8-24 bit PCM and cells end up as float magnitudes, so float32 loses nothing that survives
+// to the fingerprints while halving memory traffic and doubling SIMD width. Every stage is also instantiated for
+// double, which is kept as the reference.
+using sample_t = float;
 
 /**
- * This will split a coefficient represented polynomial into its even and odd degree terms.
- * 
- * @param p The coefficient representation of a polynomial p.  
- * @param pEven The complex vector to be populated with the coefficient representation of even degree terms of p.
- * @param pOdd The complex vector to be populated with the coefficient representation of odd degree terms of p.
+ * An FFT plan holds everything about a transform that depends only on its size, so it is built once
+ * and reused for every frame of that size. Twiddle factors (roots of unity) and the bit-reversal
+ * permutation are precomputed, and transforms run iteratively in place within the caller's buffer,
+ * so no call allocates memory or evaluates cos/sin.
+ *
+ * @note Stages are combined pairwise into radix-4 butterflies, with a single radix-2 stage up front
+ * when log2(n) is odd. The sign convention matches evaluating a polynomial at w^j, w = e^(2*pi*i/n).
  */
-void splitPolynomialByEvenOddDegrees(complex_vector &p, complex_vector &pEven, complex_vector &pOdd);
+class FftPlan {
+public:
+    /**
+     * @param n The transform size. Must be a power of two and at least 2.
+     */
+    explicit FftPlan(size_t n);
+
+    size_t size() const { return n; }
+    size_t numOfRealBins() const { return n / 2 + 1; }
+
+    /**
+     * Complex to complex transform of n points.
+     *
+     * @param in The n input points.
+     * @param out The n output bins. May be the same buffer as in.
+     */
+    void forward(const complex_number *in, complex_number *out) const;
+
+    /**
+     * Real to complex transform of n points. The upper half of the spectrum of a real signal is the
+     * complex conjugate mirror of the lower half, so only the n/2 + 1 non-redundant bins are produced.
+     * Internally this packs even/odd samples into one n/2 point complex transform, costing about half
+     * of a full complex transform.
+     *
+     * @param in The n real input samples.
+     * @param out The n/2 + 1 output bins (DC through Nyquist).
+     */
+    void forwardReal(const double *in, complex_number *out) const;
+
+private:
+    size_t n;
+    std::vector<complex_number> twiddles; // w^k for k < n/2
+    std::vector<uint32_t> bitReversal; // Bit reversed index of each k < n
+
+    void transform(complex_number *data, size_t m) const;
+};
 
 /**
- * This is the recursive implementation of FFT, translating a polynomial in coefficient representation to 
- * its value representation.
- * 
- * @param p The coefficient representation of a polynomial p. 
+ * Fast Fourier Transform (FFT) translates the coefficient representation of a polynomial into
+ * its respective value representation.
+ *
+ * @param p The coefficient representation of a polynomial p. Its size must be a power of two.
  * @return The value representation of polynomial p.
+ *
+ * @note In the context of signals, p is a signal as a amplitude/time vector in its time domain
+ * and performing an FFT on p will result in the signal in it's frequency domain. Convenience wrapper
+ * around a (per thread) cached FftPlan; hot loops should hold their own plan and output buffer.
  */
-complex_vector recFFT(complex_vector p);
\ No newline at end of file
+complex_vector FFT(const std::vector<double> &p);
@@ -0,0 +1,106 @@
+#include "FftKernels.h"
+#include "CpuFeatures.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+template <typename Real>
+struct ScalarVec {
+    using scalar = Real;
+    using type = Real;
+    static constexpr size_t lanes = 1;
+    static type load(const Real *p) { return *p; }
+    static void store(Real *p, type v) { *p = v; }
+    static type set1(Real v) { return v; }
+    static type add(type a, type b) { return a + b; }
+    static type sub(type a, type b) { return a - b; }
+    static type mul(type a, type b) { return a * b; }
+};
+
+#if defined(__SSE2__)
+struct Sse2Vec {
+    using scalar = double;
+    using type = __m128d;
+    static constexpr size_t lanes = 2;
+    static type load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, type v) { _mm_storeu_pd(p, v); }
+    static type set1(double v) { return _mm_set1_pd(v); }
+    static type add(type a, type b) { return _mm_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm_mul_pd(a, b); }
+};
+
+struct Sse2VecF {
+    using scalar = float;
+    using type = __m128;
+    static constexpr size_t lanes = 4;
+    static type load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, type v) { _mm_storeu_ps(p, v); }
+    static type set1(float v) { return _mm_set1_ps(v); }
+    static type add(type a, type b) { return _mm_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+};
+#endif
+
+#include "FftKernels.inl"
+
+template <typename Real>
+void dispatchBatchTransform(Real *re, Real *im, size_t m, size_t width, const Real *twRe, const Real *twIm,
+                            size_t twStride) {
+    switch (simdLevel()) {
+#if defined(__x86_64__) || defined(__i386__)
+        case SimdLevel::Avx2:
+            fftBatchTransformAvx2(re, im, m, width, twRe, twIm, twStride);
+            break;
+#endif
+        case SimdLevel::Sse2:
+            fftBatchTransformSse2(re, im, m, width, twRe, twIm, twStride);
+            break;
+        default:
+            fftBatchTransformScalar(re, im, m, width, twRe, twIm, twStride);
+            break;
+    }
+}
+
+} // namespace
+
+void fftBatchTransformScalar(double *re, double *im, size_t m, size_t width, const double *twRe,
+                             const double *twIm, size_t twStride) {
+    batchTransform<ScalarVec<double>, ScalarVec<double>>(re, im, m, width, twRe, twIm, twStride);
+}
+
+void fftBatchTransformScalar(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                             size_t twStride) {
+    batchTransform<ScalarVec<float>, ScalarVec<float>>(re, im, m, width, twRe, twIm, twStride);
+}
+
+void fftBatchTransformSse2(double *re, double *im, size_t m, size_t width, const double *twRe,
+                           const double *twIm, size_t twStride) {
+#if defined(__SSE2__)
+    batchTransform<Sse2Vec, ScalarVec<double>>(re, im, m, width, twRe, twIm, twStride);
+#else
+    fftBatchTransformScalar(re, im, m, width, twRe, twIm, twStride);
+#endif
+}
+
+void fftBatchTransformSse2(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                           size_t twStride) {
+#if defined(__SSE2__)
+    batchTransform<Sse2VecF, ScalarVec<float>>(re, im, m, width, twRe, twIm, twStride);
+#else
+    fftBatchTransformScalar(re, im, m, width, twRe, twIm, twStride);
+#endif
+}
+
+void fftBatchTransform(double *re, double *im, size_t m, size_t width, const double *twRe, const double *twIm,
+                       size_t twStride) {
+    dispatchBatchTransform(re, im, m, width, twRe, twIm, twStride);
+}
+
+void fftBatchTransform(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                       size_t twStride) {
+    dispatchBatchTransform(re, im, m, width, twRe, twIm, twStride);
+}
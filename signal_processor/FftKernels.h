@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * Batched FFT butterflies over a structure-of-arrays (split real/imaginary) layout. Point k of lane
+ * (frame) f lives at re[k * width + f] and im[k * width + f], so one SIMD register holds the same point
+ * of several frames and every butterfly is applied to all of them at once.
+ *
+ * @param re The real parts of m points for each of width lanes, in bit reversed point order.
+ * @param im The imaginary parts, laid out like re.
+ * @param m The transform size (power of two).
+ * @param width The number of lanes (frames) in the batch. Need not be a multiple of the vector width.
+ * @param twRe The real parts of the roots of unity w^k of a size (m * twStride) transform.
+ * @param twIm The imaginary parts of those roots of unity.
+ * @param twStride The table step between consecutive roots of unity of a size m transform.
+ *
+ * @note The kernel is picked once per call from simdLevel(). Every level performs the same operations in
+ * the same order (no fused multiply-add), so results are bit identical whichever one runs. The float version
+ * holds twice as many lanes per vector as the double one.
+ */
+void fftBatchTransform(double *re, double *im, size_t m, size_t width, const double *twRe, const double *twIm,
+                       size_t twStride);
+void fftBatchTransform(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                       size_t twStride);
+
+// Per instruction set implementations behind fftBatchTransform
+void fftBatchTransformScalar(double *re, double *im, size_t m, size_t width, const double *twRe,
+                             const double *twIm, size_t twStride);
+void fftBatchTransformSse2(double *re, double *im, size_t m, size_t width, const double *twRe,
+                           const double *twIm, size_t twStride);
+void fftBatchTransformAvx2(double *re, double *im, size_t m, size_t width, const double *twRe,
+                           const double *twIm, size_t twStride);
+void fftBatchTransformScalar(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                             size_t twStride);
+void fftBatchTransformSse2(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                           size_t twStride);
+void fftBatchTransformAvx2(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                           size_t twStride);
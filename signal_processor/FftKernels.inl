@@ -0,0 +1,106 @@
+// Batched radix-4 FFT kernel shared by every instruction set. Each translation unit that includes this
+// defines a vector type V first (inside an anonymous namespace, so the differently compiled copies never
+// merge at link time) providing:
+//     using scalar; using type; static constexpr size_t lanes;
+//     load(const scalar*), store(scalar*, type), set1(scalar), add(a, b), sub(a, b), mul(a, b)
+
+// Complex (xr + i * xi) * (wr + i * wi) for one vector of lanes against a broadcast twiddle
+template <typename V>
+inline void cmul(typename V::type wr, typename V::type wi, typename V::type &xr, typename V::type &xi) {
+    typename V::type r = V::sub(V::mul(wr, xr), V::mul(wi, xi));
+    typename V::type i = V::add(V::mul(wr, xi), V::mul(wi, xr));
+    xr = r;
+    xi = i;
+}
+
+// One radix-4 butterfly on rows r0..r3 (r_k = r0 + k * len), for lanes [lane, lane + V::lanes)
+template <typename V>
+inline void radix4(typename V::scalar *re, typename V::scalar *im, size_t r0, size_t len, size_t width, size_t lane,
+                   typename V::scalar w1r, typename V::scalar w1i, typename V::scalar w2r, typename V::scalar w2i) {
+    using T = typename V::type;
+    size_t i0 = r0 * width + lane;
+    size_t i1 = i0 + len * width;
+    size_t i2 = i1 + len * width;
+    size_t i3 = i2 + len * width;
+
+    T a0r = V::load(re + i0), a0i = V::load(im + i0);
+    T a1r = V::load(re + i1), a1i = V::load(im + i1);
+    T a2r = V::load(re + i2), a2i = V::load(im + i2);
+    T a3r = V::load(re + i3), a3i = V::load(im + i3);
+
+    T vw1r = V::set1(w1r), vw1i = V::set1(w1i);
+    cmul<V>(vw1r, vw1i, a1r, a1i);
+    cmul<V>(vw1r, vw1i, a3r, a3i);
+    T b0r = V::add(a0r, a1r), b0i = V::add(a0i, a1i);
+    T b1r = V::sub(a0r, a1r), b1i = V::sub(a0i, a1i);
+    T c0r = V::add(a2r, a3r), c0i = V::add(a2i, a3i);
+    T c1r = V::sub(a2r, a3r), c1i = V::sub(a2i, a3i);
+
+    T vw2r = V::set1(w2r), vw2i = V::set1(w2i);
+    cmul<V>(vw2r, vw2i, c0r, c0i);
+    cmul<V>(vw2r, vw2i, c1r, c1i);
+    // Multiply c1 by w_4 = i
+    T t = c1r;
+    c1r = V::sub(V::set1(0), c1i);
+    c1i = t;
+
+    V::store(re + i0, V::add(b0r, c0r));
+    V::store(im + i0, V::add(b0i, c0i));
+    V::store(re + i2, V::sub(b0r, c0r));
+    V::store(im + i2, V::sub(b0i, c0i));
+    V::store(re + i1, V::add(b1r, c1r));
+    V::store(im + i1, V::add(b1i, c1i));
+    V::store(re + i3, V::sub(b1r, c1r));
+    V::store(im + i3, V::sub(b1i, c1i));
+}
+
+template <typename V>
+inline void radix2(typename V::scalar *re, typename V::scalar *im, size_t r0, size_t width, size_t lane) {
+    using T = typename V::type;
+    size_t i0 = r0 * width + lane;
+    size_t i1 = i0 + width;
+    T ar = V::load(re + i0), ai = V::load(im + i0);
+    T br = V::load(re + i1), bi = V::load(im + i1);
+    V::store(re + i0, V::add(ar, br));
+    V::store(im + i0, V::add(ai, bi));
+    V::store(re + i1, V::sub(ar, br));
+    V::store(im + i1, V::sub(ai, bi));
+}
+
+// Same pass structure as FftPlan::transform, applied to every lane. Lanes past the last full vector fall
+// back to ScalarV, which performs the identical sequence of operations.
+template <typename V, typename ScalarV>
+void batchTransform(typename V::scalar *re, typename V::scalar *im, size_t m, size_t width,
+                    const typename V::scalar *twRe, const typename V::scalar *twIm, size_t twStride) {
+    using Real = typename V::scalar;
+    size_t vectorWidth = width - width % V::lanes;
+    size_t len = 1;
+
+    size_t log2m = 0;
+    while ((size_t(1) << log2m) < m) log2m++;
+    if (log2m % 2 == 1) {
+        for (size_t r = 0; r < m; r += 2) {
+            size_t lane = 0;
+            for (; lane < vectorWidth; lane += V::lanes) radix2<V>(re, im, r, width, lane);
+            for (; lane < width; lane++) radix2<ScalarV>(re, im, r, width, lane);
+        }
+        len = 2;
+    }
+
+    for (; len < m; len *= 4) {
+        size_t twStep = twStride * (m / (4 * len));
+        for (size_t block = 0; block < m; block += 4 * len) {
+            for (size_t j = 0; j < len; j++) {
+                Real w1r = twRe[2 * j * twStep], w1i = twIm[2 * j * twStep];
+                Real w2r = twRe[j * twStep], w2i = twIm[j * twStep];
+                size_t lane = 0;
+                for (; lane < vectorWidth; lane += V::lanes) {
+                    radix4<V>(re, im, block + j, len, width, lane, w1r, w1i, w2r, w2i);
+                }
+                for (; lane < width; lane++) {
+                    radix4<ScalarV>(re, im, block + j, len, width, lane, w1r, w1i, w2r, w2i);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+// Built with -mavx2 (see CMakeLists.txt); only reached once simdLevel() has confirmed AVX2 support.
+#include "FftKernels.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+
+template <typename Real>
+struct ScalarVec {
+    using scalar = Real;
+    using type = Real;
+    static constexpr size_t lanes = 1;
+    static type load(const Real *p) { return *p; }
+    static void store(Real *p, type v) { *p = v; }
+    static type set1(Real v) { return v; }
+    static type add(type a, type b) { return a + b; }
+    static type sub(type a, type b) { return a - b; }
+    static type mul(type a, type b) { return a * b; }
+};
+
+struct Avx2Vec {
+    using scalar = double;
+    using type = __m256d;
+    static constexpr size_t lanes = 4;
+    static type load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, type v) { _mm256_storeu_pd(p, v); }
+    static type set1(double v) { return _mm256_set1_pd(v); }
+    static type add(type a, type b) { return _mm256_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+};
+
+struct Avx2VecF {
+    using scalar = float;
+    using type = __m256;
+    static constexpr size_t lanes = 8;
+    static type load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, type v) { _mm256_storeu_ps(p, v); }
+    static type set1(float v) { return _mm256_set1_ps(v); }
+    static type add(type a, type b) { return _mm256_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+};
+
+#include "FftKernels.inl"
+
+} // namespace
+
+void fftBatchTransformAvx2(double *re, double *im, size_t m, size_t width, const double *twRe,
+                           const double *twIm, size_t twStride) {
+    batchTransform<Avx2Vec, ScalarVec<double>>(re, im, m, width, twRe, twIm, twStride);
+}
+
+void fftBatchTransformAvx2(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                           size_t twStride) {
+    batchTransform<Avx2VecF, ScalarVec<float>>(re, im, m, width, twRe, twIm, twStride);
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+// Compiler without AVX2 support: dispatch still links, but falls back to SSE2
+void fftBatchTransformAvx2(double *re, double *im, size_t m, size_t width, const double *twRe,
+                           const double *twIm, size_t twStride) {
+    fftBatchTransformSse2(re, im, m, width, twRe, twIm, twStride);
+}
+
+void fftBatchTransformAvx2(float *re, float *im, size_t m, size_t width, const float *twRe, const float *twIm,
+                           size_t twStride) {
+    fftBatchTransformSse2(re, im, m, width, twRe, twIm, twStride);
+}
+
+#endif
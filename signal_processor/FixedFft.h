@@ -0,0 +1,297 @@
+#pragma once
+#include "Fft.h"
+#include "FftKernels.h"
+
+#define FFT_BATCH_WIDTH 8 // Frames transformed together by the batched FFT (a multiple of every vector width)
+
+namespace fft_detail {
+
+// Taylor series for |x| <= pi/4, where 14 terms are well past double precision
+constexpr double taylorSin(double x) {
+    double term = x;
+    double sum = x;
+    for (int i = 1; i < 14; i++) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double taylorCos(double x) {
+    double term = 1.0;
+    double sum = 1.0;
+    for (int i = 1; i < 14; i++) {
+        term *= -x * x / ((2 * i - 1) * (2 * i));
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * The root of unity w^k = e^(2*pi*i*k/n), evaluated at compile time (std::cos/std::sin are not constexpr).
+ * The angle is folded into the first octant using exact symmetries on k before the series is summed.
+ */
+constexpr complex_number unitRoot(size_t k, size_t n) {
+    double a = double(k % n);
+    double half = double(n) / 2;
+    double quarter = double(n) / 4;
+    double eighth = double(n) / 8;
+
+    double sinSign = 1.0;
+    double cosSign = 1.0;
+    if (a > half) { // sin(2pi - t) = -sin(t)
+        a = double(n) - a;
+        sinSign = -1.0;
+    }
+    if (a > quarter) { // cos(pi - t) = -cos(t)
+        a = half - a;
+        cosSign = -1.0;
+    }
+    double c = 0.0;
+    double s = 0.0;
+    if (a > eighth) { // cos(pi/2 - t) = sin(t)
+        double x = 2 * M_PI * (quarter - a) / double(n);
+        c = taylorSin(x);
+        s = taylorCos(x);
+    } else {
+        double x = 2 * M_PI * a / double(n);
+        c = taylorCos(x);
+        s = taylorSin(x);
+    }
+    return {cosSign * c, sinSign * s};
+}
+
+// Roots of unity w^k, k < N/2, split into real and imaginary arrays for the batched kernels. They are always
+// evaluated in double and then rounded once, so a float table is as accurate as float allows.
+template <size_t N, typename Real>
+struct TwiddleTable {
+    Real re[N / 2];
+    Real im[N / 2];
+
+    constexpr TwiddleTable() : re(), im() {
+        for (size_t k = 0; k < N / 2; k++) {
+            complex_number w = unitRoot(k, N);
+            re[k] = Real(w.real());
+            im[k] = Real(w.imag());
+        }
+    }
+};
+
+template <size_t N>
+struct BitReversalTable {
+    uint32_t index[N];
+
+    constexpr BitReversalTable() : index() {
+        size_t bits = 0;
+        while ((size_t(1) << bits) < N) bits++;
+        for (size_t k = 0; k < N; k++) {
+            uint32_t r = 0;
+            for (size_t b = 0; b < bits; b++) {
+                if (k & (size_t(1) << b)) r |= uint32_t(1) << (bits - 1 - b);
+            }
+            index[k] = r;
+        }
+    }
+};
+
+constexpr size_t log2(size_t n) {
+    size_t bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+    return bits;
+}
+
+} // namespace fft_detail
+
+/**
+ * An FFT specialized for a size known at compile time (e.g. FRAME_SIZE). Unlike FftPlan, which builds its
+ * tables at runtime, the twiddle factors and bit reversal permutation are constexpr tables and every pass of
+ * the single frame transform is unrolled at compile time.
+ *
+ * The batched entry points transform many frames at once in a structure-of-arrays layout where one SIMD lane
+ * holds one frame; the butterflies are AVX2, SSE2 or scalar, chosen by runtime CPU dispatch (see CpuFeatures.h).
+ *
+ * @tparam Real The precision of samples, bins and arithmetic: double, or float for twice the lanes per vector.
+ * @note Uses the same sign convention and bin layout as FftPlan.
+ */
+template <size_t N, typename Real = double>
+class Fft {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Fft size must be a power of two >= 2");
+
+public:
+    using complex_type = std::complex<Real>;
+    static constexpr size_t size = N;
+    static constexpr size_t numOfRealBins = N / 2 + 1;
+
+    /**
+     * Complex to complex transform of one frame, in place.
+     *
+     * @param data The N input points, overwritten with the N output bins.
+     */
+    static void forward(complex_type *data) {
+        for (size_t k = 0; k < N; k++) {
+            size_t r = bitReversal.index[k];
+            if (k < r) std::swap(data[k], data[r]);
+        }
+        passes<N, 1>(data);
+    }
+
+    /**
+     * Real to complex transform of one frame, producing the N/2 + 1 non-redundant bins.
+     *
+     * @param in The N real input samples.
+     * @param out The N/2 + 1 output bins.
+     */
+    static void forwardReal(const Real *in, complex_type *out) {
+        constexpr size_t h = N / 2;
+        for (size_t k = 0; k < h; k++) {
+            size_t m = bitReversal.index[2 * k];
+            out[k] = {in[2 * m], in[2 * m + 1]};
+        }
+        passes<h, 1>(out);
+
+        complex_type z0 = out[0];
+        out[0] = {z0.real() + z0.imag(), Real(0)};
+        out[h] = {z0.real() - z0.imag(), Real(0)};
+        for (size_t k = 1; k <= h / 2; k++) {
+            complex_type e;
+            complex_type wo;
+            splitBin(out[k], out[h - k], twiddle(k), e, wo);
+            out[k] = e + wo;
+            out[h - k] = std::conj(e - wo);
+        }
+    }
+
+    /**
+     * Complex to complex transform of width frames at once, in place. Point k of frame f is at
+     * re[k * width + f] and im[k * width + f].
+     *
+     * @param re The real parts of the N points of every frame.
+     * @param im The imaginary parts of the N points of every frame.
+     * @param width The number of frames in the batch.
+     */
+    static void forwardBatch(Real *re, Real *im, size_t width) {
+        for (size_t k = 0; k < N; k++) {
+            size_t r = bitReversal.index[k];
+            if (k >= r) continue;
+            for (size_t f = 0; f < width; f++) {
+                std::swap(re[k * width + f], re[r * width + f]);
+                std::swap(im[k * width + f], im[r * width + f]);
+            }
+        }
+        fftBatchTransform(re, im, N, width, twiddles.re, twiddles.im, 1);
+    }
+
+    /**
+     * Real to complex transform of up to FFT_BATCH_WIDTH frames at once. Frames are windowed while they are
+     * packed into the batch layout, so the caller can point straight into the signal without copying.
+     *
+     * @param frames The N real samples of each frame.
+     * @param out The N/2 + 1 output bins of each frame.
+     * @param width The number of frames (at most FFT_BATCH_WIDTH).
+     * @param window Per sample weights applied before the transform, or nullptr for none (rectangle).
+     * @param scratchRe Scratch for N/2 * FFT_BATCH_WIDTH values, reused across calls.
+     * @param scratchIm Scratch for N/2 * FFT_BATCH_WIDTH values, reused across calls.
+     *
+     * @note Each lane is transformed independently of the others, so a frame's bins do not depend on which
+     * batch or lane it was computed in.
+     */
+    static void forwardRealBatch(const Real *const *frames, complex_type *const *out, size_t width,
+                                 const Real *window, Real *scratchRe, Real *scratchIm) {
+        constexpr size_t h = N / 2;
+        for (size_t k = 0; k < h; k++) {
+            size_t m = bitReversal.index[2 * k];
+            Real *rowRe = scratchRe + k * width;
+            Real *rowIm = scratchIm + k * width;
+            for (size_t f = 0; f < width; f++) {
+                Real even = frames[f][2 * m];
+                Real odd = frames[f][2 * m + 1];
+                if (window) {
+                    even *= window[2 * m];
+                    odd *= window[2 * m + 1];
+                }
+                rowRe[f] = even;
+                rowIm[f] = odd;
+            }
+        }
+        fftBatchTransform(scratchRe, scratchIm, h, width, twiddles.re, twiddles.im, 2);
+
+        for (size_t f = 0; f < width; f++) {
+            complex_type z0 = {scratchRe[f], scratchIm[f]};
+            out[f][0] = {z0.real() + z0.imag(), Real(0)};
+            out[f][h] = {z0.real() - z0.imag(), Real(0)};
+        }
+        for (size_t k = 1; k <= h / 2; k++) {
+            complex_type w = twiddle(k);
+            for (size_t f = 0; f < width; f++) {
+                complex_type zk = {scratchRe[k * width + f], scratchIm[k * width + f]};
+                complex_type zhk = {scratchRe[(h - k) * width + f], scratchIm[(h - k) * width + f]};
+                complex_type e;
+                complex_type wo;
+                splitBin(zk, zhk, w, e, wo);
+                out[f][k] = e + wo;
+                out[f][h - k] = std::conj(e - wo);
+            }
+        }
+    }
+
+private:
+    static constexpr fft_detail::TwiddleTable<N, Real> twiddles{};
+    static constexpr fft_detail::BitReversalTable<N> bitReversal{};
+
+    static constexpr complex_type twiddle(size_t k) { return {twiddles.re[k], twiddles.im[k]}; }
+
+    // Separate bin k of a packed real transform into its even (e) and twiddled odd (wo) sample spectra. Written
+    // out in real arithmetic since std::complex multiplication carries NaN/infinity recovery checks.
+    static void splitBin(complex_type zk, complex_type zhk, complex_type w, complex_type &e, complex_type &wo) {
+        const Real half = Real(0.5);
+        Real er = half * (zk.real() + zhk.real());
+        Real ei = half * (zk.imag() - zhk.imag());
+        Real or_ = half * (zk.imag() + zhk.imag()); // (zk - conj(zhk)) / 2i
+        Real oi = -half * (zk.real() - zhk.real());
+        e = {er, ei};
+        wo = {w.real() * or_ - w.imag() * oi, w.real() * oi + w.imag() * or_};
+    }
+
+    // Radix-4 passes (with a leading radix-2 pass when log2(M) is odd) for a size M transform, recursing on
+    // the sub transform length so the pass loop is fully resolved at compile time
+    template <size_t M, size_t Len>
+    static void passes(complex_type *data) {
+        if constexpr (Len >= M) {
+            return;
+        } else if constexpr (Len == 1 && fft_detail::log2(M) % 2 == 1) {
+            for (size_t i = 0; i < M; i += 2) {
+                complex_type a = data[i];
+                complex_type b = data[i + 1];
+                data[i] = a + b;
+                data[i + 1] = a - b;
+            }
+            passes<M, 2>(data);
+        } else {
+            constexpr size_t twStep = N / (4 * Len);
+            for (size_t block = 0; block < M; block += 4 * Len) {
+                complex_type *a0 = data + block;
+                complex_type *a1 = a0 + Len;
+                complex_type *a2 = a1 + Len;
+                complex_type *a3 = a2 + Len;
+                for (size_t j = 0; j < Len; j++) {
+                    complex_type w1 = twiddle(2 * j * twStep);
+                    complex_type w2 = twiddle(j * twStep);
+
+                    complex_type t1 = w1 * a1[j];
+                    complex_type t3 = w1 * a3[j];
+                    complex_type b0 = a0[j] + t1;
+                    complex_type b1 = a0[j] - t1;
+                    complex_type c0 = w2 * (a2[j] + t3);
+                    complex_type c1 = w2 * (a2[j] - t3);
+                    c1 = {-c1.imag(), c1.real()};
+
+                    a0[j] = b0 + c0;
+                    a2[j] = b0 - c0;
+                    a1[j] = b1 + c1;
+                    a3[j] = b1 - c1;
+                }
+            }
+            passes<M, 4 * Len>(data);
+        }
+    }
+};
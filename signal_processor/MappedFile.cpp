@@ -0,0 +1,65 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        bytes = std::exchange(other.bytes, nullptr);
+        length = std::exchange(other.length, 0);
+        isOpen = std::exchange(other.isOpen, false);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &filePath, bool sequential) {
+    close();
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open file: " << filePath << "\n";
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        std::cerr << "Failed to stat file: " << filePath << "\n";
+        ::close(fd);
+        return false;
+    }
+
+    length = size_t(info.st_size);
+    if (length > 0) {
+        void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Failed to map file: " << filePath << "\n";
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        bytes = static_cast<const uint8_t *>(mapping);
+        if (sequential) madvise(mapping, length, MADV_SEQUENTIAL);
+    }
+
+    ::close(fd); // The mapping keeps its own reference to the file
+    isOpen = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) munmap(const_cast<uint8_t *>(bytes), length);
+    bytes = nullptr;
+    length = 0;
+    isOpen = false;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * A read only memory mapping of a whole file. Pages are faulted in from the page cache on first touch, so
+ * opening is constant time and nothing is copied into process memory up front.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    /**
+     * Map a file, replacing any existing mapping.
+     *
+     * @param filePath The file to map.
+     * @param sequential True to hint the kernel to read ahead aggressively (e.g. for one pass decoding).
+     * @return True if and only if the file was opened and mapped. Empty files map to a valid, empty mapping.
+     */
+    bool open(const std::string &filePath, bool sequential = false);
+    void close();
+
+    const uint8_t *data() const { return bytes; }
+    size_t size() const { return length; }
+    operator bool() const { return isOpen; }
+
+private:
+    const uint8_t *bytes = nullptr;
+    size_t length = 0;
+    bool isOpen = false;
+};
@@ -0,0 +1,260 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+namespace {
+
+constexpr size_t NUM_OF_STAGES = size_t(Stage::Count);
+
+struct Label {
+    PcmFormat format;
+    uint32_t sampleRate;
+};
+
+// One thread's counters. Only the owning thread writes them, so adding is a plain load and store; they are atomic
+// so snapshots can read them while the thread runs.
+struct Counters {
+    std::atomic<uint64_t> calls[METRICS_MAX_LABELS][NUM_OF_STAGES] = {};
+    std::atomic<uint64_t> ns[METRICS_MAX_LABELS][NUM_OF_STAGES] = {};
+    std::atomic<uint64_t> items[METRICS_MAX_LABELS][NUM_OF_STAGES] = {};
+};
+
+struct ThreadMetrics;
+
+// Every live thread's counters, the totals of exited threads and the labels. Never destroyed, so threads (and
+// writeMetricsAtExit) may use it however late they run.
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadMetrics *> threads;
+    uint64_t retiredCalls[METRICS_MAX_LABELS][NUM_OF_STAGES] = {};
+    uint64_t retiredNs[METRICS_MAX_LABELS][NUM_OF_STAGES] = {};
+    uint64_t retiredItems[METRICS_MAX_LABELS][NUM_OF_STAGES] = {};
+    Label labels[METRICS_MAX_LABELS] = {{PcmFormat::Unsupported, 0}}; // Label 0 is unlabeled
+    size_t numOfLabels = 1;
+    std::string exitPath;
+};
+
+Registry &registry() {
+    static Registry *instance = new Registry();
+    return *instance;
+}
+
+struct ThreadMetrics {
+    Counters counters;
+
+    ThreadMetrics() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(this);
+    }
+
+    // Fold this thread's counters into the retired totals so they outlive it
+    ~ThreadMetrics() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (size_t l = 0; l < METRICS_MAX_LABELS; l++) {
+            for (size_t s = 0; s < NUM_OF_STAGES; s++) {
+                r.retiredCalls[l][s] += counters.calls[l][s].load(std::memory_order_relaxed);
+                r.retiredNs[l][s] += counters.ns[l][s].load(std::memory_order_relaxed);
+                r.retiredItems[l][s] += counters.items[l][s].load(std::memory_order_relaxed);
+            }
+        }
+        r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+    }
+};
+
+thread_local uint32_t currentLabel = 0;
+
+void add(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+const char *formatName(PcmFormat format) {
+    switch (format) {
+        case PcmFormat::U8: return "u8";
+        case PcmFormat::S16: return "s16";
+        case PcmFormat::S24: return "s24";
+        case PcmFormat::S32: return "s32";
+        case PcmFormat::F32: return "f32";
+        default: return "";
+    }
+}
+
+void writeMetricsFile() {
+    Registry &r = registry();
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        path = r.exitPath;
+    }
+    if (!path.empty()) writeMetrics(path);
+}
+
+} // namespace
+
+const char *stageName(Stage stage) {
+    switch (stage) {
+        case Stage::WavLoad: return "wav_load";
+        case Stage::Decode: return "decode";
+        case Stage::Filter: return "filter";
+        case Stage::Downsample: return "downsample";
+        case Stage::Resample: return "resample";
+        case Stage::Fft: return "fft";
+        case Stage::SpectrogramAssembly: return "spectrogram_assembly";
+        case Stage::Visualize: return "visualize";
+        case Stage::Cache: return "cache";
+        default: return "unknown";
+    }
+}
+
+const char *stageUnit(Stage stage) {
+    switch (stage) {
+        case Stage::WavLoad: return "bytes";
+        case Stage::Cache: return "bytes";
+        case Stage::Decode: return "frames";
+        case Stage::Fft: return "frames";
+        case Stage::SpectrogramAssembly: return "frames";
+        case Stage::Visualize: return "cells";
+        default: return "samples";
+    }
+}
+
+#if defined(INTUNE_METRICS)
+
+bool metricsEnabled() {
+    return true;
+}
+
+void recordStage(Stage stage, uint64_t ns, uint64_t items) {
+    thread_local ThreadMetrics metrics;
+    size_t s = size_t(stage);
+    add(metrics.counters.calls[currentLabel][s], 1);
+    add(metrics.counters.ns[currentLabel][s], ns);
+    add(metrics.counters.items[currentLabel][s], items);
+}
+
+#else
+
+bool metricsEnabled() {
+    return false;
+}
+
+void recordStage(Stage, uint64_t, uint64_t) {}
+
+#endif
+
+MetricsLabel::MetricsLabel(PcmFormat format, uint32_t sampleRate) : previous(currentLabel) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    uint32_t id = 0;
+    for (size_t l = 1; l < r.numOfLabels && !id; l++) {
+        if (r.labels[l].format == format && r.labels[l].sampleRate == sampleRate) id = uint32_t(l);
+    }
+    if (!id && r.numOfLabels < METRICS_MAX_LABELS) {
+        id = uint32_t(r.numOfLabels++);
+        r.labels[id] = {format, sampleRate};
+    }
+    currentLabel = id;
+}
+
+MetricsLabel::MetricsLabel(uint32_t id) : previous(currentLabel) {
+    currentLabel = id < METRICS_MAX_LABELS ? id : 0;
+}
+
+MetricsLabel::~MetricsLabel() {
+    currentLabel = previous;
+}
+
+uint32_t MetricsLabel::current() {
+    return currentLabel;
+}
+
+std::vector<StageMetrics> metricsSnapshot() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<StageMetrics> snapshot;
+    for (size_t l = 0; l < r.numOfLabels; l++) {
+        for (size_t s = 0; s < NUM_OF_STAGES; s++) {
+            StageMetrics m{Stage(s), r.labels[l].format, r.labels[l].sampleRate, r.retiredCalls[l][s],
+                           r.retiredNs[l][s], r.retiredItems[l][s]};
+            for (const ThreadMetrics *thread : r.threads) {
+                m.calls += thread->counters.calls[l][s].load(std::memory_order_relaxed);
+                m.ns += thread->counters.ns[l][s].load(std::memory_order_relaxed);
+                m.items += thread->counters.items[l][s].load(std::memory_order_relaxed);
+            }
+            if (m.calls) snapshot.push_back(m);
+        }
+    }
+    return snapshot;
+}
+
+void writeMetricsJson(std::ostream &out) {
+    std::vector<StageMetrics> snapshot = metricsSnapshot();
+    out << std::setprecision(9);
+    out << "{\n  \"enabled\": " << (metricsEnabled() ? "true" : "false") << ",\n  \"stages\": [";
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        const StageMetrics &m = snapshot[i];
+        out << (i ? ",\n" : "\n") << "    {\"stage\": \"" << stageName(m.stage) << "\", \"format\": \""
+            << formatName(m.format) << "\", \"sample_rate\": " << m.sampleRate << ", \"calls\": " << m.calls
+            << ", \"seconds\": " << m.ns * 1e-9 << ", \"items\": " << m.items << ", \"unit\": \""
+            << stageUnit(m.stage) << "\"}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void writeMetricsPrometheus(std::ostream &out) {
+    std::vector<StageMetrics> snapshot = metricsSnapshot();
+    auto labels = [&](const StageMetrics &m) {
+        out << "{stage=\"" << stageName(m.stage) << "\"";
+        if (m.sampleRate) out << ",format=\"" << formatName(m.format) << "\",sample_rate=\"" << m.sampleRate << "\"";
+        out << "}";
+    };
+
+    out << std::setprecision(9);
+    out << "# HELP intune_stage_calls_total Calls of each pipeline stage.\n"
+        << "# TYPE intune_stage_calls_total counter\n";
+    for (const StageMetrics &m : snapshot) {
+        out << "intune_stage_calls_total";
+        labels(m);
+        out << " " << m.calls << "\n";
+    }
+    out << "# HELP intune_stage_seconds_total Time spent in each pipeline stage, summed over threads.\n"
+        << "# TYPE intune_stage_seconds_total counter\n";
+    for (const StageMetrics &m : snapshot) {
+        out << "intune_stage_seconds_total";
+        labels(m);
+        out << " " << m.ns * 1e-9 << "\n";
+    }
+    out << "# HELP intune_stage_items_total Work done by each pipeline stage, in the stage's unit.\n"
+        << "# TYPE intune_stage_items_total counter\n";
+    for (const StageMetrics &m : snapshot) {
+        out << "intune_stage_items_total";
+        labels(m);
+        out << " " << m.items << "\n";
+    }
+}
+
+bool writeMetrics(const std::string &path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Failed to open metrics file: " << path << "\n";
+        return false;
+    }
+    bool prometheus = path.size() >= 5 && path.compare(path.size() - 5, 5, ".prom") == 0;
+    if (prometheus) writeMetricsPrometheus(out);
+    else writeMetricsJson(out);
+    return bool(out);
+}
+
+void writeMetricsAtExit(const std::string &path) {
+    if (path.empty()) return;
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.exitPath.empty()) std::atexit(writeMetricsFile);
+    r.exitPath = path;
+}
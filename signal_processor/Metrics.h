@@ -0,0 +1,153 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "PcmDecode.h"
+
+#define METRICS_MAX_LABELS 64 // Distinct (format, sample rate) labels kept; later ones are counted as unlabeled
+
+/**
+ * Time and throughput of each pipeline stage, for seeing which stage dominates for which files without attaching a
+ * profiler, e.g.
+ *
+ *     MetricsLabel label(PcmFormat::S16, 44100); // Attribute this thread's stages to 16 bit 44.1 kHz audio
+ *     {
+ *         INTUNE_STAGE(Stage::Decode, frames); // Times the rest of the scope (one per scope), counting frames
+ *         decodePcm(...);
+ *     }
+ *     writeMetricsPrometheus(std::cout);
+ *
+ * Every thread accumulates into its own counters (no locks or shared cache lines in the hot path), which are only
+ * summed when a snapshot is taken, so times are totals over every thread that ran a stage. Stages do not nest:
+ * each one times only its own work (the FFT stage excludes reducing bins into spectrogram storage, and so on).
+ *
+ * Timing is compiled in when INTUNE_METRICS is defined (the CMake option of the same name); otherwise the
+ * INTUNE_STAGE macros expand to nothing and every snapshot is empty.
+ */
+
+// Pipeline stages, in pipeline order
+enum class Stage : uint8_t {
+    WavLoad, // Opening, mapping or reading a .wav file and walking its chunks (items: bytes)
+    Decode, // PCM to normalized samples (items: sample frames)
+    Filter, // The first order low pass filter (items: samples)
+    Downsample, // Averaging decimation (items: input samples)
+    Resample, // The polyphase anti-alias filter and rate change, the filter and downsample of the pipeline
+              // (items: input samples)
+    Fft, // Windowing and transforming STFT frames (items: frames)
+    SpectrogramAssembly, // Allocating spectrograms and reducing bins into their storage (items: frames)
+    Visualize, // Rendering a spectrogram to an image or tiles (items: spectrogram cells)
+    Cache, // Hashing .wav data chunks for, looking up and writing fingerprint cache entries (items: bytes)
+    Count,
+};
+
+const char *stageName(Stage stage);
+
+// What the items of a stage count, e.g. "frames"
+const char *stageUnit(Stage stage);
+
+// True if and only if this build times stages
+bool metricsEnabled();
+
+// Add one call of a stage, lasting ns nanoseconds and covering items items, to the calling thread's counters
+void recordStage(Stage stage, uint64_t ns, uint64_t items);
+
+/**
+ * Times the scope it lives in as one call of a stage. Use through INTUNE_STAGE so it compiles out.
+ */
+class ScopedStage {
+public:
+    explicit ScopedStage(Stage stage, uint64_t items = 0)
+        : stage(stage), items(items), start(std::chrono::steady_clock::now()) {}
+    ~ScopedStage() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        recordStage(stage, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), items);
+    }
+
+    ScopedStage(const ScopedStage &) = delete;
+    ScopedStage &operator=(const ScopedStage &) = delete;
+
+    // For scopes that only learn how much they did at the end
+    void setItems(uint64_t count) { items = count; }
+
+private:
+    Stage stage;
+    uint64_t items;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Attributes every stage the calling thread runs while it is alive to one file format and sample rate, restoring
+ * the previous label when it goes out of scope. Worker threads start unlabeled; pass them the id of the caller's
+ * label to carry it over.
+ */
+class MetricsLabel {
+public:
+    MetricsLabel(PcmFormat format, uint32_t sampleRate);
+    explicit MetricsLabel(uint32_t id);
+    ~MetricsLabel();
+
+    MetricsLabel(const MetricsLabel &) = delete;
+    MetricsLabel &operator=(const MetricsLabel &) = delete;
+
+    // The label the calling thread is attributing stages to (0 when unlabeled)
+    static uint32_t current();
+
+private:
+    uint32_t previous;
+};
+
+#if defined(INTUNE_METRICS)
+// Time the rest of the enclosing scope as one call of a stage, optionally covering a number of items
+#define INTUNE_STAGE(...) ScopedStage intuneStage(__VA_ARGS__)
+// Set the items covered by the enclosing scope's INTUNE_STAGE, once they are known
+#define INTUNE_STAGE_ITEMS(count) intuneStage.setItems(count)
+// Attribute the rest of the enclosing scope's stages to a file format and sample rate (or a label id)
+#define INTUNE_METRICS_LABEL(...) MetricsLabel intuneMetricsLabel(__VA_ARGS__)
+#else
+#define INTUNE_STAGE(...) ((void)0)
+#define INTUNE_STAGE_ITEMS(count) ((void)0)
+#define INTUNE_METRICS_LABEL(...) ((void)0)
+#endif
+
+// The totals of one stage under one label
+struct StageMetrics {
+    Stage stage;
+    PcmFormat format; // PcmFormat::Unsupported when unlabeled
+    uint32_t sampleRate; // 0 when unlabeled
+    uint64_t calls;
+    uint64_t ns;
+    uint64_t items;
+};
+
+/**
+ * Sum every thread's counters, including those of threads that have exited.
+ *
+ * @return The totals of every (stage, label) pair that has been called, by label then stage. Threads still
+ * running may be mid way through a call, so a snapshot lags them by at most one call each.
+ */
+std::vector<StageMetrics> metricsSnapshot();
+
+// Write a snapshot as a JSON object
+void writeMetricsJson(std::ostream &out);
+
+// Write a snapshot in the Prometheus text exposition format
+void writeMetricsPrometheus(std::ostream &out);
+
+/**
+ * Write a snapshot to a file, as Prometheus text if its name ends in .prom and as JSON otherwise.
+ *
+ * @param path The file to (over)write.
+ * @return True if and only if the file was written.
+ */
+bool writeMetrics(const std::string &path);
+
+/**
+ * Write a snapshot to a file (as writeMetrics does) when the program exits normally. Only the last path given is
+ * written.
+ *
+ * @param path The file to write at exit.
+ */
+void writeMetricsAtExit(const std::string &path);
@@ -0,0 +1,124 @@
+#include "PcmDecode.h"
+#include "CpuFeatures.h"
+#include <cstring>
+
+// Same codes as WAVE_FORMAT_PCM / WAVE_FORMAT_IEEE_FLOAT in Wav.h
+#define PCM_FORMAT_CODE_INT 1
+#define PCM_FORMAT_CODE_FLOAT 3
+
+PcmFormat pcmFormat(uint16_t audioFormat, uint16_t bitsPerSample) {
+    if (audioFormat == PCM_FORMAT_CODE_FLOAT) return bitsPerSample == 32 ? PcmFormat::F32 : PcmFormat::Unsupported;
+    if (audioFormat != PCM_FORMAT_CODE_INT) return PcmFormat::Unsupported;
+    switch (bitsPerSample) {
+        case 8: return PcmFormat::U8;
+        case 16: return PcmFormat::S16;
+        case 24: return PcmFormat::S24;
+        case 32: return PcmFormat::S32;
+        default: return PcmFormat::Unsupported;
+    }
+}
+
+size_t pcmBytesPerSample(PcmFormat format) {
+    switch (format) {
+        case PcmFormat::U8: return 1;
+        case PcmFormat::S16: return 2;
+        case PcmFormat::S24: return 3;
+        case PcmFormat::S32:
+        case PcmFormat::F32: return 4;
+        default: return 0;
+    }
+}
+
+namespace {
+
+// One sample normalized to [-1, 1]. Integers convert exactly and are scaled by a power of two, which is
+// exact too, so only S32 to float rounds (to nearest, exactly like the vector conversion).
+template <typename Out, PcmFormat Format>
+inline Out decodeSample(const uint8_t *p) {
+    if constexpr (Format == PcmFormat::U8) {
+        return Out(int(p[0]) - 128) * Out(1.0 / 128); // 2^8 / 2
+    } else if constexpr (Format == PcmFormat::S16) {
+        int16_t val;
+        std::memcpy(&val, p, 2);
+        return Out(val) * Out(1.0 / 32768); // 2^16 / 2
+    } else if constexpr (Format == PcmFormat::S24) {
+        int32_t val = int32_t(uint32_t(p[0]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 24) >> 8; // Sign extend
+        return Out(val) * Out(1.0 / 8388608); // 2^24 / 2
+    } else if constexpr (Format == PcmFormat::S32) {
+        int32_t val;
+        std::memcpy(&val, p, 4);
+        return Out(val) * Out(1.0 / 2147483648.0); // 2^32 / 2
+    } else {
+        float val;
+        std::memcpy(&val, p, 4);
+        return Out(val);
+    }
+}
+
+// Channels == 0 means a channel count only known at runtime
+template <typename Out, PcmFormat Format, size_t Channels>
+void decodeFrames(const uint8_t *src, size_t frames, size_t channels, Out *out, bool convertToMono) {
+    constexpr size_t bytesPerSample = Format == PcmFormat::U8 ? 1 : Format == PcmFormat::S16 ? 2
+                                    : Format == PcmFormat::S24 ? 3 : 4;
+    if (Channels) channels = Channels;
+
+    if (!convertToMono || channels == 1) {
+        for (size_t i = 0; i < frames * channels; i++) out[i] = decodeSample<Out, Format>(src + i * bytesPerSample);
+    } else if (channels == 2) {
+        for (size_t i = 0; i < frames; i++) {
+            const uint8_t *frame = src + i * 2 * bytesPerSample;
+            Out left = decodeSample<Out, Format>(frame);
+            Out right = decodeSample<Out, Format>(frame + bytesPerSample);
+            out[i] = (left + right) * Out(0.5);
+        }
+    } else {
+        for (size_t i = 0; i < frames; i++) {
+            const uint8_t *frame = src + i * channels * bytesPerSample;
+            Out monoSum = decodeSample<Out, Format>(frame);
+            for (size_t ch = 1; ch < channels; ch++) monoSum += decodeSample<Out, Format>(frame + ch * bytesPerSample);
+            out[i] = monoSum / Out(channels);
+        }
+    }
+}
+
+template <typename Out, PcmFormat Format>
+void decodeFormat(const uint8_t *src, size_t frames, size_t channels, Out *out, bool convertToMono) {
+    switch (channels) {
+        case 1: decodeFrames<Out, Format, 1>(src, frames, channels, out, convertToMono); break;
+        case 2: decodeFrames<Out, Format, 2>(src, frames, channels, out, convertToMono); break;
+        default: decodeFrames<Out, Format, 0>(src, frames, channels, out, convertToMono); break;
+    }
+}
+
+template <typename Out>
+void decodeScalar(PcmFormat format, const uint8_t *src, size_t frames, size_t channels, Out *out,
+                  bool convertToMono) {
+    switch (format) {
+        case PcmFormat::U8: decodeFormat<Out, PcmFormat::U8>(src, frames, channels, out, convertToMono); break;
+        case PcmFormat::S16: decodeFormat<Out, PcmFormat::S16>(src, frames, channels, out, convertToMono); break;
+        case PcmFormat::S24: decodeFormat<Out, PcmFormat::S24>(src, frames, channels, out, convertToMono); break;
+        case PcmFormat::S32: decodeFormat<Out, PcmFormat::S32>(src, frames, channels, out, convertToMono); break;
+        case PcmFormat::F32: decodeFormat<Out, PcmFormat::F32>(src, frames, channels, out, convertToMono); break;
+        default: break;
+    }
+}
+
+} // namespace
+
+void decodePcm(PcmFormat format, const uint8_t *src, size_t frames, size_t channels, float *out,
+               bool convertToMono) {
+    if (channels == 0) return;
+    size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (simdLevel() == SimdLevel::Avx2) done = decodePcmAvx2(format, src, frames, channels, out, convertToMono);
+#endif
+    size_t outPerFrame = convertToMono ? 1 : channels;
+    decodeScalar(format, src + done * channels * pcmBytesPerSample(format), frames - done, channels,
+                 out + done * outPerFrame, convertToMono);
+}
+
+void decodePcm(PcmFormat format, const uint8_t *src, size_t frames, size_t channels, double *out,
+               bool convertToMono) {
+    if (channels == 0) return;
+    decodeScalar(format, src, frames, channels, out, convertToMono);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Sample encodings found in .wav data chunks
+enum class PcmFormat {
+    Unsupported,
+    U8, // Unsigned 8 bit, 128 = silence
+    S16, // Signed 16 bit little endian
+    S24, // Signed 24 bit little endian, packed in 3 bytes
+    S32, // Signed 32 bit little endian
+    F32, // IEEE 754 float
+};
+
+/**
+ * @param audioFormat The fmt chunk format code, with WAVE_FORMAT_EXTENSIBLE already resolved to its subformat.
+ * @param bitsPerSample The fmt chunk bits per sample.
+ * @return The matching sample encoding, or PcmFormat::Unsupported.
+ */
+PcmFormat pcmFormat(uint16_t audioFormat, uint16_t bitsPerSample);
+
+size_t pcmBytesPerSample(PcmFormat format);
+
+/**
+ * Decode interleaved PCM into normalized [-1, 1] samples, optionally averaging all channels of each frame
+ * into one (mono) sample in the same pass. The format and channel layout are dispatched once per call, to
+ * AVX2 kernels when the CPU supports them (float output, mono and stereo) or else to scalar loops
+ * specialized per format and channel count.
+ *
+ * @param format The encoding of src.
+ * @param src The interleaved sample frames.
+ * @param frames The number of sample frames (one sample per channel) to decode.
+ * @param channels The number of channels per frame.
+ * @param out Receives frames samples when convertToMono, otherwise frames * channels interleaved samples.
+ * @param convertToMono True to average the channels of each frame.
+ *
+ * @note Results do not depend on which kernel ran: the vector and scalar paths round identically.
+ */
+void decodePcm(PcmFormat format, const uint8_t *src, size_t frames, size_t channels, float *out,
+               bool convertToMono = true);
+void decodePcm(PcmFormat format, const uint8_t *src, size_t frames, size_t channels, double *out,
+               bool convertToMono = true);
+
+/**
+ * AVX2 float kernels behind decodePcm. Handles mono output from 1 or 2 channels, and interleaved output of
+ * any channel count, for whole vectors of frames only.
+ *
+ * @return The number of leading frames decoded; the caller finishes the rest with the scalar path.
+ */
+size_t decodePcmAvx2(PcmFormat format, const uint8_t *src, size_t frames, size_t channels, float *out,
+                     bool convertToMono);
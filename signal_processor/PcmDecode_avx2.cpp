@@ -0,0 +1,88 @@
+// Built with -mavx2 (see CMakeLists.txt); only reached once simdLevel() has confirmed AVX2 support.
+#include "PcmDecode.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+
+// Load 8 consecutive samples as normalized floats. S24 reads 4 bytes past the 8th sample.
+template <PcmFormat Format>
+inline __m256 load8(const uint8_t *p) {
+    if constexpr (Format == PcmFormat::U8) {
+        __m256i val = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+        val = _mm256_sub_epi32(val, _mm256_set1_epi32(128));
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(val), _mm256_set1_ps(1.0f / 128));
+    } else if constexpr (Format == PcmFormat::S16) {
+        __m256i val = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(val), _mm256_set1_ps(1.0f / 32768));
+    } else if constexpr (Format == PcmFormat::S24) {
+        // Samples 0-3 from bytes 0-11 in the low half, samples 4-7 from bytes 12-23 in the high half. Each
+        // 3 byte sample moves to the top of its 32 bit lane and an arithmetic shift sign extends it.
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12));
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        const __m256i spread = _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+                                                -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+        __m256i val = _mm256_srai_epi32(_mm256_shuffle_epi8(bytes, spread), 8);
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(val), _mm256_set1_ps(1.0f / 8388608));
+    } else if constexpr (Format == PcmFormat::S32) {
+        __m256i val = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(val), _mm256_set1_ps(1.0f / 2147483648.0f));
+    } else {
+        return _mm256_loadu_ps(reinterpret_cast<const float *>(p));
+    }
+}
+
+template <PcmFormat Format>
+size_t decode(const uint8_t *src, size_t frames, size_t channels, float *out, bool convertToMono) {
+    constexpr size_t bytesPerSample = Format == PcmFormat::U8 ? 1 : Format == PcmFormat::S16 ? 2
+                                    : Format == PcmFormat::S24 ? 3 : 4;
+    constexpr size_t spare = Format == PcmFormat::S24 ? 2 : 0; // Samples that must follow a vector load
+    size_t total = frames * channels;
+    if (total < 16 + spare) return 0;
+    size_t limit = total - spare; // Sample loads must end at or before this
+
+    if (!convertToMono || channels == 1) {
+        size_t i = 0;
+        for (; i + 8 <= limit; i += 8) _mm256_storeu_ps(out + i, load8<Format>(src + i * bytesPerSample));
+        return i / channels;
+    }
+    if (channels == 2) {
+        // 8 stereo frames per step: hadd sums each left/right pair, but interleaves the two source vectors
+        // by 128 bit half, so a 64 bit lane permute restores frame order
+        size_t i = 0;
+        for (; 2 * i + 16 <= limit; i += 8) {
+            const uint8_t *p = src + 2 * i * bytesPerSample;
+            __m256 a = load8<Format>(p);
+            __m256 b = load8<Format>(p + 8 * bytesPerSample);
+            __m256 sum = _mm256_hadd_ps(a, b);
+            sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), 0xD8));
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(sum, _mm256_set1_ps(0.5f)));
+        }
+        return i;
+    }
+    return 0;
+}
+
+} // namespace
+
+size_t decodePcmAvx2(PcmFormat format, const uint8_t *src, size_t frames, size_t channels, float *out,
+                     bool convertToMono) {
+    switch (format) {
+        case PcmFormat::U8: return decode<PcmFormat::U8>(src, frames, channels, out, convertToMono);
+        case PcmFormat::S16: return decode<PcmFormat::S16>(src, frames, channels, out, convertToMono);
+        case PcmFormat::S24: return decode<PcmFormat::S24>(src, frames, channels, out, convertToMono);
+        case PcmFormat::S32: return decode<PcmFormat::S32>(src, frames, channels, out, convertToMono);
+        case PcmFormat::F32: return decode<PcmFormat::F32>(src, frames, channels, out, convertToMono);
+        default: return 0;
+    }
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+// Compiler without AVX2 support: decodePcm finishes everything on the scalar path
+size_t decodePcmAvx2(PcmFormat, const uint8_t *, size_t, size_t, float *, bool) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include "Peaks.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+
+const float LOWEST = -std::numeric_limits<float>::infinity();
+
+/**
+ * out[i] = max(in[i - r .. i + r]), clamped to the array, by van Herk/Gil-Werman: the array is padded by r
+ * either side and cut into blocks of 2r + 1, and any window of that length is the suffix maximum of the block
+ * it starts in combined with the prefix maximum of the block it ends in.
+ */
+void runningMax(const float *in, size_t n, size_t r, float *out, float *padded, float *prefix, float *suffix) {
+    size_t w = 2 * r + 1;
+    size_t length = n + 2 * r;
+    std::fill(padded, padded + r, LOWEST);
+    std::copy(in, in + n, padded + r);
+    std::fill(padded + r + n, padded + length, LOWEST);
+
+    for (size_t start = 0; start < length; start += w) {
+        size_t end = std::min(start + w, length);
+        prefix[start] = padded[start];
+        for (size_t j = start + 1; j < end; j++) prefix[j] = std::max(prefix[j - 1], padded[j]);
+        suffix[end - 1] = padded[end - 1];
+        for (size_t j = end - 1; j > start; j--) suffix[j - 1] = std::max(suffix[j], padded[j - 1]);
+    }
+    for (size_t i = 0; i < n; i++) out[i] = std::max(suffix[i], prefix[i + 2 * r]);
+}
+
+} // namespace
+
+PeakExtractor::PeakExtractor(size_t numOfBins, PeakParams params)
+    : params(std::move(params)), numOfBins(numOfBins), block(2 * this->params.timeRadius + 1),
+      position(this->params.timeRadius), cells(block * numOfBins), spread(block * numOfBins, LOWEST),
+      prefix(numOfBins, LOWEST), suffix(block * numOfBins, LOWEST),
+      freqPadded(numOfBins + 2 * this->params.frequencyRadius), freqPrefix(freqPadded.size()),
+      freqSuffix(freqPadded.size()),
+      neighborhood(numOfBins), magnitudes(numOfBins) {}
+
+void PeakExtractor::push(const float *frameCells) {
+    std::copy(frameCells, frameCells + numOfBins, cells.begin() + (frames % block) * numOfBins);
+    frames++;
+    advance(frameCells);
+}
+
+void PeakExtractor::push(const complex_number *bins) {
+    MagnitudeStorage::fromBins(bins, magnitudes.data(), numOfBins);
+    push(magnitudes.data());
+}
+
+void PeakExtractor::push(const std::complex<float> *bins) {
+    MagnitudeStorage::fromBins(bins, magnitudes.data(), numOfBins);
+    push(magnitudes.data());
+}
+
+void PeakExtractor::flush() {
+    // The frames past the end are padding that never wins a maximum
+    for (size_t i = 0; i < params.timeRadius; i++) advance(nullptr);
+}
+
+std::vector<Peak> PeakExtractor::takePeaks() {
+    return std::exchange(found, {});
+}
+
+void PeakExtractor::takePeaks(std::vector<Peak> &out) {
+    out.clear();
+    std::swap(out, found);
+}
+
+void PeakExtractor::reset() {
+    frames = 0;
+    position = params.timeRadius;
+    std::fill(cells.begin(), cells.end(), 0.0f);
+    std::fill(spread.begin(), spread.end(), LOWEST);
+    std::fill(prefix.begin(), prefix.end(), LOWEST);
+    std::fill(suffix.begin(), suffix.end(), LOWEST);
+    found.clear();
+}
+
+void PeakExtractor::advance(const float *frameCells) {
+    size_t r = params.timeRadius;
+    size_t offset = position % block;
+    float *row = spread.data() + offset * numOfBins;
+    if (frameCells) {
+        runningMax(frameCells, numOfBins, params.frequencyRadius, row, freqPadded.data(), freqPrefix.data(),
+                   freqSuffix.data());
+    } else {
+        std::fill(row, row + numOfBins, LOWEST);
+    }
+
+    if (offset == 0) std::copy(row, row + numOfBins, prefix.begin());
+    else for (size_t b = 0; b < numOfBins; b++) prefix[b] = std::max(prefix[b], row[b]);
+
+    // This frame completes the neighborhood of the frame r before it, whose window (counting the padding) starts
+    // 2r positions back, which is that frame's own index
+    if (position >= 2 * r && position - 2 * r < frames) decide(position - 2 * r);
+
+    // Once a block is complete its suffix maxima serve every window starting in it
+    if (offset == block - 1) {
+        float *last = suffix.data() + offset * numOfBins;
+        std::copy(row, row + numOfBins, last);
+        for (size_t i = block - 1; i > 0; i--) {
+            const float *next = suffix.data() + i * numOfBins;
+            const float *s = spread.data() + (i - 1) * numOfBins;
+            float *out = suffix.data() + (i - 1) * numOfBins;
+            for (size_t b = 0; b < numOfBins; b++) out[b] = std::max(s[b], next[b]);
+        }
+    }
+    position++;
+}
+
+void PeakExtractor::decide(size_t frame) {
+    // A window starting on a block boundary is exactly the current block; otherwise it straddles the previous one
+    size_t startOffset = frame % block;
+    if (startOffset == 0) {
+        std::copy(prefix.begin(), prefix.end(), neighborhood.begin());
+    } else {
+        const float *s = suffix.data() + startOffset * numOfBins;
+        for (size_t b = 0; b < numOfBins; b++) neighborhood[b] = std::max(s[b], prefix[b]);
+    }
+
+    const float *row = cells.data() + (frame % block) * numOfBins;
+    const std::vector<uint16_t> &starts = params.bandStarts;
+    for (size_t band = 0; band < starts.size(); band++) {
+        size_t begin = std::min<size_t>(starts[band], numOfBins);
+        size_t end = band + 1 < starts.size() ? std::min<size_t>(starts[band + 1], numOfBins) : numOfBins;
+
+        candidates.clear();
+        for (size_t b = begin; b < end; b++) {
+            if (row[b] > params.minMagnitude && row[b] >= neighborhood[b]) {
+                candidates.push_back({uint32_t(frame), uint16_t(b), row[b]});
+            }
+        }
+
+        // Keep the strongest few, still in bin order
+        if (candidates.size() > params.peaksPerBand) {
+            std::partial_sort(candidates.begin(), candidates.begin() + params.peaksPerBand, candidates.end(),
+                              [](const Peak &a, const Peak &b) { return a.mag > b.mag; });
+            candidates.resize(params.peaksPerBand);
+            std::sort(candidates.begin(), candidates.end(), [](const Peak &a, const Peak &b) { return a.bin < b.bin; });
+        }
+        found.insert(found.end(), candidates.begin(), candidates.end());
+    }
+}
+
+std::vector<Peak> extractPeaks(SpectrogramView<const float> s, const PeakParams &params) {
+    PeakExtractor extractor(s.cols(), params);
+    std::vector<float> row(s.hasContiguousRows() ? 0 : s.cols());
+    for (size_t r = 0; r < s.rows(); r++) {
+        if (s.hasContiguousRows()) {
+            extractor.push(s.row(r));
+        } else {
+            for (size_t c = 0; c < s.cols(); c++) row[c] = s(r, c);
+            extractor.push(row.data());
+        }
+    }
+    extractor.flush();
+    return extractor.takePeaks();
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Fft.h"
+#include "SpectrogramMatrix.h"
+
+#define PEAK_TIME_RADIUS 16 // Frames either side of a peak it must be the loudest over (~46 ms at HOP_SIZE)
+#define PEAK_FREQUENCY_RADIUS 8 // Bins either side of a peak it must be the loudest over (~86 Hz)
+#define PEAKS_PER_BAND 1 // Strongest peaks kept per frequency band per frame
+
+// A spectral peak: one point of the constellation map a fingerprint is built from
+struct Peak {
+    uint32_t frame; // Spectrogram row (time)
+    uint16_t bin; // Spectrogram column (frequency)
+    float mag; // The cell's value (magnitude, or decibels for LogMagnitudeStorage)
+};
+
+// How peaks are picked out of a spectrogram
+struct PeakParams {
+    size_t timeRadius = PEAK_TIME_RADIUS;
+    size_t frequencyRadius = PEAK_FREQUENCY_RADIUS;
+
+    // Cells must be strictly above this to be peaks (so silence, where every cell ties, never is). In the units
+    // of the cells: magnitude by default, decibels when extracting from a LogMagnitudeStorage spectrogram.
+    float minMagnitude = 0.0f;
+
+    // First bin of each band, ascending; a band runs up to the next band's first bin (the last one to the end of
+    // the row). Low frequencies are split finer since that is where most musical energy sits.
+    std::vector<uint16_t> bandStarts = {0, 10, 20, 40, 80, 160};
+    size_t peaksPerBand = PEAKS_PER_BAND;
+};
+
+/**
+ * Finds spectral peaks in spectrogram frames as they arrive. A cell is a peak when it is the maximum of the
+ * (2 * timeRadius + 1) x (2 * frequencyRadius + 1) cells around it and above minMagnitude, and then only the
+ * strongest peaksPerBand peaks of each band of a frame are kept.
+ *
+ * The neighborhood maximum is separable, so it is taken as a running maximum along frequency within each frame
+ * and then along time across frames. Both use the van Herk/Gil-Werman algorithm (block wise prefix and suffix
+ * maxima, combined two at a time), which costs about 3 comparisons per cell no matter the radius.
+ *
+ * @note A frame can only be decided once the timeRadius frames after it have arrived, so peaks trail the input by
+ * latency() frames until flush() is called.
+ */
+class PeakExtractor {
+public:
+    /**
+     * @param numOfBins The number of bins in each frame (e.g. FRAME_SIZE / 2 + 1).
+     * @param params Neighborhood, threshold and band layout.
+     */
+    explicit PeakExtractor(size_t numOfBins, PeakParams params = {});
+
+    /**
+     * Feed the next frame of cells.
+     *
+     * @param cells The numOfBins values of the frame.
+     */
+    void push(const float *cells);
+
+    /**
+     * Feed the next frame as complex FFT bins (e.g. straight from a StreamingStft callback); peaks are picked by
+     * magnitude.
+     *
+     * @param bins The numOfBins complex bins of the frame.
+     */
+    void push(const complex_number *bins);
+    void push(const std::complex<float> *bins);
+
+    // Signal the end of the input, deciding the last latency() frames
+    void flush();
+
+    /**
+     * Hand over the peaks found so far.
+     *
+     * @return The peaks since the last call, sorted by frame and then bin.
+     */
+    std::vector<Peak> takePeaks();
+
+    /**
+     * Hand over the peaks found so far without allocating: out's storage is swapped in to collect the next ones.
+     *
+     * @param out Receives the peaks since the last call, sorted by frame and then bin.
+     */
+    void takePeaks(std::vector<Peak> &out);
+
+    // Start a new signal, keeping every buffer (e.g. a worker moving on to the next file)
+    void reset();
+
+    size_t latency() const { return params.timeRadius; }
+    size_t framesPushed() const { return frames; }
+
+private:
+    PeakParams params;
+    size_t numOfBins;
+    size_t block; // Time block length of the running maximum: 2 * timeRadius + 1
+
+    size_t frames = 0; // Frames pushed so far
+    size_t position; // Position of the next frame, counting the timeRadius frames of padding before the signal
+
+    std::vector<float> cells; // The last block frames as pushed, row (frame % block)
+    std::vector<float> spread; // Their frequency running maxima, row (position % block) of the current block
+    std::vector<float> prefix; // Running maximum (over time) from the start of the current block up to now
+    std::vector<float> suffix; // Maximum from each row to the end of the previous block, row (position % block)
+
+    // Scratch for the frequency running maximum, the decided frame's neighborhood maximum and magnitudes
+    std::vector<float> freqPadded;
+    std::vector<float> freqPrefix;
+    std::vector<float> freqSuffix;
+    std::vector<float> neighborhood;
+    std::vector<float> magnitudes;
+    std::vector<Peak> candidates;
+
+    std::vector<Peak> found;
+
+    void advance(const float *frameCells);
+    void decide(size_t frame);
+};
+
+/**
+ * Extract the peaks of a whole spectrogram (see PeakExtractor).
+ *
+ * @param s A view of the cells indexed [time][frequency], e.g. spectrogram.view().
+ * @param params Neighborhood, threshold and band layout.
+ * @return The peaks, sorted by frame and then bin.
+ */
+std::vector<Peak> extractPeaks(SpectrogramView<const float> s, const PeakParams &params = {});
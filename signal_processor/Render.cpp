@@ -0,0 +1,402 @@
+#include "Render.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#if defined(INTUNE_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace {
+
+/*---------Pooling----------*/
+
+// The cells [first, last) of an axis of n cells that fall in pixel p of count pixels (count <= n)
+inline size_t poolStart(size_t p, size_t n, size_t count) {
+    return p * n / count;
+}
+
+// Reads frames of a [time][frequency] view in decibels and pools them into a grid of height rows. Both poolings are
+// separable, so frames are pooled over time first, a whole frame at a time (which vectorizes), and each column's
+// bins are pooled into rows only once.
+class FramePooler {
+public:
+    FramePooler(SpectrogramView<const float> frames, size_t height, const RenderParams &params)
+        : frames(frames), height(height), pooling(params.pooling), convert(!params.decibels),
+          cells(frames.cols()), staged(frames.cols()), pooled(frames.cols()), bounds(height + 1) {
+        for (size_t r = 0; r <= height; r++) bounds[r] = poolStart(r, frames.cols(), height);
+    }
+
+    // Pool frames [first, last) into columns [0, columns) of grid (height rows of stride floats), columns <= frames
+    void poolColumns(size_t first, size_t last, size_t columns, float *grid, size_t stride) {
+        const size_t numOfBins = frames.cols();
+        size_t n = last - first;
+        for (size_t c = 0; c < columns; c++) {
+            size_t t0 = first + poolStart(c, n, columns);
+            size_t t1 = first + poolStart(c + 1, n, columns);
+            const float *bins = load(t0);
+            if (t1 - t0 > 1) {
+                std::copy(bins, bins + numOfBins, pooled.begin());
+                for (size_t t = t0 + 1; t < t1; t++) {
+                    bins = load(t);
+                    if (pooling == Pooling::Max) {
+                        for (size_t f = 0; f < numOfBins; f++) pooled[f] = std::max(pooled[f], bins[f]);
+                    } else {
+                        for (size_t f = 0; f < numOfBins; f++) pooled[f] += bins[f];
+                    }
+                }
+                bins = pooled.data();
+            }
+
+            float scale = pooling == Pooling::Mean ? 1.0f / float(t1 - t0) : 1.0f;
+            for (size_t r = 0; r < height; r++) {
+                const float *lo = bins + bounds[r];
+                const float *hi = bins + bounds[r + 1];
+                float v;
+                if (pooling == Pooling::Max) {
+                    v = *std::max_element(lo, hi);
+                } else {
+                    v = 0.0f;
+                    for (const float *p = lo; p < hi; p++) v += *p;
+                    v *= scale / float(hi - lo);
+                }
+                grid[r * stride + c] = v;
+            }
+        }
+    }
+
+private:
+    // Frame t in decibels, read in place when it already is and its bins are contiguous
+    const float *load(size_t t) {
+        const float *row = frames.row(t);
+        if (!frames.hasContiguousRows()) {
+            for (size_t f = 0; f < staged.size(); f++) staged[f] = frames(t, f);
+            row = staged.data();
+        }
+        if (!convert) return row;
+        magnitudesToDecibels(row, cells.data(), cells.size());
+        return cells.data();
+    }
+
+    SpectrogramView<const float> frames;
+    size_t height;
+    Pooling pooling;
+    bool convert;
+    std::vector<float> cells; // The frame being read, in decibels
+    std::vector<float> staged; // The frame being read, gathered from a strided view
+    std::vector<float> pooled; // The frames of the current column pooled so far
+    std::vector<size_t> bounds; // Row r pools bins [bounds[r], bounds[r + 1])
+};
+
+/*---------Colormap----------*/
+
+// Nine evenly spaced samples of matplotlib's magma (the map the OpenCV viewer uses), interpolated in between
+const uint8_t MAGMA[9][3] = {
+    {0x00, 0x00, 0x04}, {0x1D, 0x11, 0x47}, {0x51, 0x12, 0x7C}, {0x82, 0x26, 0x81}, {0xB6, 0x36, 0x79},
+    {0xE6, 0x51, 0x64}, {0xFB, 0x88, 0x61}, {0xFE, 0xC2, 0x87}, {0xFC, 0xFD, 0xBF},
+};
+
+struct Colormap {
+    uint8_t lut[256][3];
+
+    Colormap() {
+        for (int i = 0; i < 256; i++) {
+            double x = i * 8.0 / 255.0;
+            int k = std::min(7, int(x));
+            double w = x - k;
+            for (int ch = 0; ch < 3; ch++) {
+                lut[i][ch] = uint8_t(std::lround(MAGMA[k][ch] * (1.0 - w) + MAGMA[k + 1][ch] * w));
+            }
+        }
+    }
+};
+
+const Colormap &colormap() {
+    static const Colormap instance;
+    return instance;
+}
+
+// Colormap columns [0, columns) of a pooled grid (rows lowest frequency first) into an image, flipped vertically
+Image colorize(const float *grid, size_t stride, size_t columns, size_t height, float floorDb, float topDb) {
+    Image image;
+    image.width = columns;
+    image.height = height;
+    image.rgb.resize(columns * height * 3);
+    const Colormap &map = colormap();
+    float scale = 255.0f / std::max(topDb - floorDb, 1e-9f);
+    for (size_t r = 0; r < height; r++) {
+        const float *row = grid + r * stride;
+        uint8_t *out = image.rgb.data() + (height - 1 - r) * columns * 3;
+        for (size_t c = 0; c < columns; c++) {
+            int level = int(std::clamp((row[c] - floorDb) * scale, 0.0f, 255.0f) + 0.5f);
+            std::memcpy(out + c * 3, map.lut[level], 3);
+        }
+    }
+    return image;
+}
+
+/*---------PNG----------*/
+
+uint32_t crc32(const uint8_t *data, size_t n, uint32_t crc = 0) {
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putU32(std::vector<uint8_t> &out, uint32_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(uint8_t(v >> shift));
+}
+
+void writeChunk(std::ostream &out, const char *type, const std::vector<uint8_t> &payload) {
+    std::vector<uint8_t> chunk;
+    putU32(chunk, uint32_t(payload.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), payload.begin(), payload.end());
+    putU32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    out.write(reinterpret_cast<const char *>(chunk.data()), std::streamsize(chunk.size()));
+}
+
+// A zlib stream of scanlines: deflated when zlib is available, otherwise in stored (uncompressed) blocks
+std::vector<uint8_t> zlibStream(const std::vector<uint8_t> &raw) {
+#if defined(INTUNE_HAVE_ZLIB)
+    uLongf size = compressBound(uLong(raw.size()));
+    std::vector<uint8_t> deflated(size);
+    if (compress2(deflated.data(), &size, raw.data(), uLong(raw.size()), Z_BEST_SPEED) == Z_OK) {
+        deflated.resize(size);
+        return deflated;
+    }
+#endif
+    std::vector<uint8_t> out = {0x78, 0x01};
+    size_t pos = 0;
+    do {
+        size_t block = std::min<size_t>(65535, raw.size() - pos);
+        bool last = pos + block == raw.size();
+        out.push_back(last ? 1 : 0);
+        out.push_back(uint8_t(block));
+        out.push_back(uint8_t(block >> 8));
+        out.push_back(uint8_t(~block));
+        out.push_back(uint8_t(~block >> 8));
+        out.insert(out.end(), raw.begin() + pos, raw.begin() + pos + block);
+        pos += block;
+    } while (pos < raw.size());
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putU32(out, (b << 16) | a);
+    return out;
+}
+
+} // namespace
+
+Image renderSpectrogram(SpectrogramView<const float> s, const RenderParams &params) {
+    if (s.empty()) return {};
+    INTUNE_STAGE(Stage::Visualize, s.rows() * s.cols());
+    size_t width = std::clamp<size_t>(params.width, 1, s.cols());
+    size_t height = std::clamp<size_t>(params.height, 1, s.rows());
+
+    // Pool [frequency][time] cells frame by frame (the view transposed back to [time][frequency] is how the cells
+    // usually lie in memory) into a grid of decibels
+    std::vector<float> grid(width * height);
+    FramePooler pooler(s.transposed(), height, params);
+    pooler.poolColumns(0, s.cols(), width, grid.data(), width);
+
+    // Anything more than dynamicRange below the peak is clamped to black
+    auto [low, high] = std::minmax_element(grid.begin(), grid.end());
+    float topDb = *high;
+    float floorDb = std::max(*low, float(topDb - params.dynamicRange));
+    return colorize(grid.data(), width, width, height, floorDb, topDb);
+}
+
+bool writePng(const Image &image, const std::string &path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Failed to open file: " << path << "\n";
+        return false;
+    }
+
+    // Every scanline is filtered with Sub (each byte less the same channel of the pixel to its left), which turns
+    // the smooth gradients of a spectrogram into runs of small values that deflate well
+    size_t rowBytes = image.width * 3;
+    std::vector<uint8_t> raw((rowBytes + 1) * image.height);
+    for (size_t y = 0; y < image.height; y++) {
+        const uint8_t *src = image.rgb.data() + y * rowBytes;
+        uint8_t *dst = raw.data() + y * (rowBytes + 1);
+        dst[0] = 1;
+        for (size_t i = 0; i < rowBytes; i++) dst[1 + i] = uint8_t(src[i] - (i >= 3 ? src[i - 3] : 0));
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.write(reinterpret_cast<const char *>(signature), 8);
+    std::vector<uint8_t> header;
+    putU32(header, uint32_t(image.width));
+    putU32(header, uint32_t(image.height));
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, deflate, adaptive filtering, no interlacing
+    writeChunk(out, "IHDR", header);
+    writeChunk(out, "IDAT", zlibStream(raw));
+    writeChunk(out, "IEND", {});
+    return bool(out);
+}
+
+bool writePpm(const Image &image, const std::string &path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Failed to open file: " << path << "\n";
+        return false;
+    }
+    out << "P6\n" << image.width << " " << image.height << "\n255\n";
+    out.write(reinterpret_cast<const char *>(image.rgb.data()), std::streamsize(image.rgb.size()));
+    return bool(out);
+}
+
+bool writeImage(const Image &image, const std::string &path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".png") return writePng(image, path);
+    if (extension == ".ppm") return writePpm(image, path);
+    std::cerr << "Unsupported image type (use .png or .ppm): " << path << "\n";
+    return false;
+}
+
+namespace {
+
+// One level of a tile pyramid under construction: the tile in progress, filled by pooling pairs of columns of the
+// two tiles below it as those are finished
+struct PyramidLevel {
+    size_t numOfTiles = 0;
+    size_t tile = 0; // The tile in progress
+    size_t columns = 0; // Columns of it filled so far
+    std::vector<float> grid = std::vector<float>(size_t(TILE_WIDTH) * TILE_HEIGHT); // Decibels, row stride TILE_WIDTH
+};
+
+class PyramidWriter {
+public:
+    PyramidWriter(const std::filesystem::path &directory, size_t height, Pooling pooling, float floorDb,
+                  float topDb, std::vector<PyramidLevel> &levels)
+        : directory(directory), height(height), pooling(pooling), floorDb(floorDb), topDb(topDb), levels(levels) {}
+
+    // Write the tile in progress at level z, pool it into level z - 1 (finishing that tile too once both of its
+    // halves are in) and move on to the next tile
+    bool finish(size_t z) {
+        PyramidLevel &level = levels[z];
+        Image image = colorize(level.grid.data(), TILE_WIDTH, level.columns, height, floorDb, topDb);
+        bool ok = writePng(image, (directory / std::to_string(z) / (std::to_string(level.tile) + ".png")).string());
+
+        if (z > 0) {
+            PyramidLevel &parent = levels[z - 1];
+            size_t offset = (level.tile % 2) * (TILE_WIDTH / 2);
+            size_t pairs = (level.columns + 1) / 2;
+            for (size_t r = 0; r < height; r++) {
+                const float *from = level.grid.data() + r * TILE_WIDTH;
+                float *into = parent.grid.data() + r * TILE_WIDTH + offset;
+                for (size_t j = 0; j < pairs; j++) {
+                    float a = from[2 * j];
+                    float b = 2 * j + 1 < level.columns ? from[2 * j + 1] : a;
+                    into[j] = pooling == Pooling::Max ? std::max(a, b) : 0.5f * (a + b);
+                }
+            }
+            parent.columns = offset + pairs;
+            if (level.tile % 2 == 1 || level.tile + 1 == level.numOfTiles) ok = finish(z - 1) && ok;
+        }
+        level.tile++;
+        level.columns = 0;
+        return ok;
+    }
+
+private:
+    std::filesystem::path directory;
+    size_t height;
+    Pooling pooling;
+    float floorDb;
+    float topDb;
+    std::vector<PyramidLevel> &levels;
+};
+
+} // namespace
+
+bool renderTilePyramid(SpectrogramView<const float> s, const std::string &directory, const RenderParams &params,
+                       double framesPerSecond) {
+    if (s.empty()) return false;
+    INTUNE_STAGE(Stage::Visualize, s.rows() * s.cols());
+    const size_t numOfFrames = s.cols();
+    const size_t height = std::min<size_t>(TILE_HEIGHT, s.rows());
+    SpectrogramView<const float> frames = s.transposed();
+
+    // Every tile shares one colour scale, so it is fixed up front from the extremes of the whole spectrogram
+    // (decibels are monotonic in magnitude, so only the two extremes need converting)
+    float low = frames(0, 0);
+    float high = low;
+    for (size_t t = 0; t < numOfFrames; t++) {
+        for (size_t f = 0; f < frames.cols(); f++) {
+            low = std::min(low, frames(t, f));
+            high = std::max(high, frames(t, f));
+        }
+    }
+    if (!params.decibels) {
+        low = fastDecibels(low);
+        high = fastDecibels(high);
+    }
+    float topDb = high;
+    float floorDb = std::max(low, float(topDb - params.dynamicRange));
+
+    // The finest level has a column per frame, and each level above halves that until one tile covers everything
+    size_t numOfLevels = 1;
+    while ((size_t(TILE_WIDTH) << (numOfLevels - 1)) < numOfFrames) numOfLevels++;
+    std::vector<PyramidLevel> levels(numOfLevels);
+    std::filesystem::path root(directory);
+    std::error_code error;
+    for (size_t z = 0; z < numOfLevels; z++) {
+        size_t framesPerTile = size_t(TILE_WIDTH) << (numOfLevels - 1 - z);
+        levels[z].numOfTiles = (numOfFrames + framesPerTile - 1) / framesPerTile;
+        std::filesystem::create_directories(root / std::to_string(z), error);
+        if (error) {
+            std::cerr << "Failed to create directory: " << (root / std::to_string(z)).string() << "\n";
+            return false;
+        }
+    }
+
+    // Render the finest tiles left to right; finishing each one cascades into the levels above
+    PyramidWriter writer(root, height, params.pooling, floorDb, topDb, levels);
+    FramePooler pooler(frames, height, params);
+    PyramidLevel &finest = levels.back();
+    bool ok = true;
+    for (size_t first = 0; first < numOfFrames; first += TILE_WIDTH) {
+        size_t last = std::min<size_t>(numOfFrames, first + TILE_WIDTH);
+        pooler.poolColumns(first, last, last - first, finest.grid.data(), TILE_WIDTH);
+        finest.columns = last - first;
+        ok = writer.finish(numOfLevels - 1) && ok;
+    }
+
+    std::ofstream manifest(root / "pyramid.json");
+    manifest << std::setprecision(10);
+    manifest << "{\n  \"tile_width\": " << TILE_WIDTH << ",\n  \"tile_height\": " << height
+             << ",\n  \"frames\": " << numOfFrames << ",\n  \"bins\": " << s.rows()
+             << ",\n  \"frames_per_second\": " << framesPerSecond << ",\n  \"pooling\": \""
+             << (params.pooling == Pooling::Max ? "max" : "mean") << "\",\n  \"floor_db\": " << floorDb
+             << ",\n  \"top_db\": " << topDb << ",\n  \"levels\": [";
+    for (size_t z = 0; z < numOfLevels; z++) {
+        manifest << (z ? ",\n" : "\n") << "    {\"level\": " << z << ", \"tiles\": " << levels[z].numOfTiles
+                 << ", \"frames_per_column\": " << (size_t(1) << (numOfLevels - 1 - z)) << "}";
+    }
+    manifest << "\n  ]\n}\n";
+    if (!manifest) {
+        std::cerr << "Failed to write: " << (root / "pyramid.json").string() << "\n";
+        return false;
+    }
+    return ok;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SpectrogramMatrix.h"
+
+#define RENDER_WIDTH 2048 // Default image width in pixels; longer spectrograms are pooled down to it
+#define RENDER_HEIGHT 512 // Default image height in pixels (FRAME_SIZE / 2 + 1 bins are pooled down to it)
+#define RENDER_DYNAMIC_RANGE 80.0 // dB below the loudest cell that map to black
+#define TILE_WIDTH 256 // Time columns per pyramid tile
+#define TILE_HEIGHT 256 // Frequency rows per pyramid tile
+
+// How the cells falling in one pixel are combined
+enum class Pooling {
+    Max, // The loudest cell; keeps short transients visible however far the image is zoomed out
+    Mean, // The mean of the cells in decibels; smoother, closer to what the ear averages
+};
+
+struct RenderParams {
+    size_t width = RENDER_WIDTH; // Never wider than the number of frames (there is no upsampling)
+    size_t height = RENDER_HEIGHT; // Never taller than the number of bins
+    Pooling pooling = Pooling::Max;
+    double dynamicRange = RENDER_DYNAMIC_RANGE;
+    bool decibels = false; // True if the cells are already in decibels (LogMagnitudeStorage) rather than magnitudes
+};
+
+// An 8 bit RGB image, rows top to bottom and pixels interleaved R, G, B
+struct Image {
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+/**
+ * Render a spectrogram as a frequency over time heat map without any windowing system, for headless servers.
+ *
+ * Cells are converted to decibels as they are read (one pass per frame, in a loop the compiler vectorizes),
+ * pooled straight into a params.width by params.height grid and only then colormapped, so no full resolution
+ * intermediate image is ever made and an hour long capture costs one read of its cells.
+ *
+ * @param s A view of the magnitudes to render, indexed [frequency][time] as for visualize.
+ * @param params The size of the image, how cells are pooled into pixels and the decibel range shown.
+ * @return The image, with low frequencies at the bottom and time running left to right; empty if s is.
+ */
+Image renderSpectrogram(SpectrogramView<const float> s, const RenderParams &params = RenderParams());
+
+/**
+ * Write an image as a PNG (deflate compressed when built with zlib, stored otherwise) or a binary PPM (P6),
+ * chosen by the extension of path.
+ *
+ * @param image The image to write.
+ * @param path A file ending in .png or .ppm.
+ * @return True if and only if the file was written.
+ */
+bool writeImage(const Image &image, const std::string &path);
+
+/**
+ * Write an image as an 8 bit RGB PNG, Sub filtered and deflate compressed when built with zlib (stored otherwise).
+ *
+ * @param image The image to write.
+ * @param path The file to write, whatever its extension.
+ * @return True if and only if the file was written.
+ */
+bool writePng(const Image &image, const std::string &path);
+
+/**
+ * Write an image as a binary PPM (P6), the simplest format most image tools read.
+ *
+ * @param image The image to write.
+ * @param path The file to write, whatever its extension.
+ * @return True if and only if the file was written.
+ */
+bool writePpm(const Image &image, const std::string &path);
+
+/**
+ * Render a spectrogram as a pyramid of fixed size PNG tiles for a zoomable viewer, the way web maps are served.
+ *
+ * The finest level has one column per frame; every coarser level halves the time resolution, down to a single
+ * tile covering the whole capture. Tile x of level z is written to directory/z/x.png (level 0 is the coarsest)
+ * and directory/pyramid.json describes the levels, the time and frequency covered by a column and row, and the
+ * decibel range of the colormap, which is shared by every tile so they line up seamlessly.
+ *
+ * Coarser levels are pooled from finer tiles as those are finished, so memory holds one tile per level
+ * regardless of length.
+ *
+ * @param s A view of the magnitudes to render, indexed [frequency][time].
+ * @param directory Where to write the tiles; created if missing.
+ * @param params How cells are pooled and the decibel range shown; tiles are always TILE_WIDTH by TILE_HEIGHT
+ * (or the number of bins, if fewer), so width and height are ignored.
+ * @param framesPerSecond The frame rate of s, recorded in the manifest.
+ * @return True if and only if every tile and the manifest were written.
+ */
+bool renderTilePyramid(SpectrogramView<const float> s, const std::string &directory, const RenderParams &params,
+                       double framesPerSecond);
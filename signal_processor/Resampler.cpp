@@ -0,0 +1,242 @@
+#include "Resampler.h"
+#include "CpuFeatures.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+namespace {
+
+// Zeroth order modified Bessel function of the first kind, for the Kaiser window
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-17) break;
+    }
+    return sum;
+}
+
+} // namespace
+
+template <typename Real>
+PolyphaseResampler<Real>::PolyphaseResampler(int inputRate, int outputRate, int zeroCrossings) {
+    if (simdLevel() == SimdLevel::Avx2) dot = dotProduct8Avx2;
+    else dot = dotProduct8Scalar;
+    if (inputRate <= 0 || outputRate <= 0 || inputRate == outputRate) {
+        passThrough = true;
+        return;
+    }
+
+    size_t g = std::gcd(inputRate, outputRate);
+    up = outputRate / g;
+    down = inputRate / g;
+
+    // Prototype low pass filter at the upsampled rate (L * inputRate), cutting off below the lower Nyquist
+    // frequency. Its sinc crosses zero every 1 / (2 * cutoff) samples; keep zeroCrossings of those each side.
+    size_t slower = std::max(up, down);
+    double cutoff = RESAMPLER_ROLLOFF * 0.5 / slower; // Cycles per upsampled sample
+    double halfLength = zeroCrossings / (2 * cutoff);
+    taps = size_t(std::ceil((2 * halfLength + 1) / up));
+    taps = (taps + 7) / 8 * 8;
+    size_t length = taps * up;
+
+    // Center the filter on a whole upsampled sample so its delay can be compensated exactly (when the length
+    // is even the last tap falls outside the window and stays zero)
+    double center = double((length - 1) / 2);
+    double i0Beta = besselI0(RESAMPLER_KAISER_BETA);
+    std::vector<double> prototype(length, 0.0);
+    for (size_t i = 0; i < 2 * size_t(center) + 1; i++) {
+        double x = i - center;
+        double arg = 2 * cutoff * x;
+        double sinc = arg == 0 ? 1.0 : std::sin(M_PI * arg) / (M_PI * arg);
+        double r = x / (center + 1);
+        double kaiser = besselI0(RESAMPLER_KAISER_BETA * std::sqrt(std::max(0.0, 1 - r * r))) / i0Beta;
+        // Gain of L makes up for the energy lost to zero stuffing
+        prototype[i] = up * 2 * cutoff * sinc * kaiser;
+    }
+
+    // Phase p uses every Lth tap starting at p; store each phase back to front (see header)
+    coefficients.resize(length);
+    for (size_t p = 0; p < up; p++) {
+        for (size_t j = 0; j < taps; j++) coefficients[p * taps + (taps - 1 - j)] = Real(prototype[p + j * up]);
+    }
+    reset();
+}
+
+template <typename Real>
+void PolyphaseResampler<Real>::reset() {
+    inputsSeen = 0;
+    inputsBuffered = 0;
+    outputsMade = 0;
+    if (passThrough) return;
+
+    // Inputs before the signal are silence
+    history.assign(taps - 1, Real(0));
+    historyStart = -(long long)(taps - 1);
+
+    nextInput = delay() / up;
+    nextPhase = delay() % up;
+}
+
+template <typename Real>
+void PolyphaseResampler<Real>::append(const Real *in, size_t count) {
+    history.insert(history.end(), in, in + count);
+    inputsBuffered += count;
+}
+
+template <typename Real>
+void PolyphaseResampler<Real>::appendSilence(size_t count) {
+    history.insert(history.end(), count, Real(0));
+    inputsBuffered += count;
+}
+
+template <typename Real>
+size_t PolyphaseResampler<Real>::drain(Real *out, size_t limit) {
+    size_t produced = 0;
+    while (produced < limit && nextInput < (long long)inputsBuffered) {
+        const Real *window = history.data() + (nextInput - (long long)(taps - 1) - historyStart);
+        out[produced++] = dot(coefficients.data() + nextPhase * taps, window, taps);
+
+        nextPhase += down;
+        nextInput += nextPhase / up;
+        nextPhase %= up;
+    }
+    outputsMade += produced;
+
+    // Forget inputs older than what the next output's window starts at
+    long long keepFrom = nextInput - (long long)(taps - 1);
+    size_t discard = size_t(std::clamp<long long>(keepFrom - historyStart, 0, (long long)history.size()));
+    history.erase(history.begin(), history.begin() + discard);
+    historyStart += discard;
+    return produced;
+}
+
+template <typename Real>
+size_t PolyphaseResampler<Real>::process(const Real *in, size_t count, Real *out) {
+    if (passThrough) {
+        std::copy(in, in + count, out);
+        inputsSeen += count;
+        outputsMade += count;
+        return count;
+    }
+
+    size_t produced = 0;
+    for (size_t i = 0; i < count; i += RESAMPLER_BLOCK_SIZE) {
+        size_t block = std::min<size_t>(RESAMPLER_BLOCK_SIZE, count - i);
+        append(in + i, block);
+        inputsSeen += block;
+        produced += drain(out + produced, SIZE_MAX);
+    }
+    return produced;
+}
+
+template <typename Real>
+size_t PolyphaseResampler<Real>::flush(Real *out) {
+    if (passThrough) return 0;
+
+    // Pad with silence until every output the real input accounts for has been made
+    size_t target = outputLengthFor(inputsSeen);
+    size_t produced = 0;
+    while (outputsMade < target) {
+        appendSilence(taps);
+        produced += drain(out + produced, target - outputsMade);
+    }
+    return produced;
+}
+
+template <typename Real>
+void PolyphaseResampler<Real>::processRange(const Real *in, size_t numOfSamples, size_t first, size_t count,
+                                            Real *out) const {
+    if (passThrough) {
+        std::copy(in + first, in + first + count, out);
+        return;
+    }
+
+    std::vector<Real> edge(taps); // Window copied out with zeros where it reaches past either end of in
+    for (size_t m = first; m < first + count; m++) {
+        uint64_t t = delay() + uint64_t(m) * down;
+        long long newest = (long long)(t / up);
+        long long oldest = newest - (long long)(taps - 1);
+        const Real *phase = coefficients.data() + (t % up) * taps;
+
+        if (oldest >= 0 && newest < (long long)numOfSamples) {
+            out[m - first] = dot(phase, in + oldest, taps);
+            continue;
+        }
+        for (size_t j = 0; j < taps; j++) {
+            long long i = oldest + (long long)j;
+            edge[j] = (i >= 0 && i < (long long)numOfSamples) ? in[i] : Real(0);
+        }
+        out[m - first] = dot(phase, edge.data(), taps);
+    }
+}
+
+template <typename Real>
+void resample(std::vector<Real> &signal, int sampleRate, int targetSampleRate, ThreadPool *pool) {
+    PolyphaseResampler<Real> resampler(sampleRate, targetSampleRate);
+    if (resampler.upFactor() == resampler.downFactor()) return;
+
+    std::vector<Real> resampled(resampler.outputLengthFor(signal.size()));
+    if (!pool) {
+        // Whole signal outputs never exceed outputLengthFor, so this is the only allocation
+        INTUNE_STAGE(Stage::Resample, signal.size());
+        size_t n = resampler.process(signal.data(), signal.size(), resampled.data());
+        resampler.flush(resampled.data() + n);
+    } else {
+        // Every output reads the input directly, so output ranges are computed independently, a few per worker
+        size_t chunks = 4 * pool->numOfWorkers();
+        size_t chunk = (resampled.size() + chunks - 1) / chunks;
+        [[maybe_unused]] uint32_t label = MetricsLabel::current();
+        pool->parallelFor(chunks, [&](size_t c, size_t) {
+            size_t first = std::min(resampled.size(), c * chunk);
+            size_t count = std::min(resampled.size() - first, chunk);
+            INTUNE_METRICS_LABEL(label);
+            INTUNE_STAGE(Stage::Resample, count * resampler.downFactor() / resampler.upFactor());
+            resampler.processRange(signal.data(), signal.size(), first, count, resampled.data() + first);
+        });
+    }
+    signal = std::move(resampled);
+}
+
+template class PolyphaseResampler<float>;
+template class PolyphaseResampler<double>;
+template void resample<float>(std::vector<float> &, int, int, ThreadPool *);
+template void resample<double>(std::vector<double> &, int, int, ThreadPool *);
+
+double dotProduct8Scalar(const double *a, const double *b, size_t n) {
+    double s[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (size_t i = 0; i < n; i += 8) {
+        for (size_t k = 0; k < 8; k++) s[k] += a[i + k] * b[i + k];
+    }
+    // Same combining order as the AVX2 kernel's two 4 lane accumulators
+    double t0 = s[0] + s[4];
+    double t1 = s[1] + s[5];
+    double t2 = s[2] + s[6];
+    double t3 = s[3] + s[7];
+    return (t0 + t2) + (t1 + t3);
+}
+
+double dotProduct8(const double *a, const double *b, size_t n) {
+    return simdLevel() == SimdLevel::Avx2 ? dotProduct8Avx2(a, b, n) : dotProduct8Scalar(a, b, n);
+}
+
+float dotProduct8Scalar(const float *a, const float *b, size_t n) {
+    float s[8] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < n; i += 8) {
+        for (size_t k = 0; k < 8; k++) s[k] += a[i + k] * b[i + k];
+    }
+    // Same combining order as the AVX2 kernel's single 8 lane accumulator, folded in halves
+    float t0 = s[0] + s[4];
+    float t1 = s[1] + s[5];
+    float t2 = s[2] + s[6];
+    float t3 = s[3] + s[7];
+    return (t0 + t2) + (t1 + t3);
+}
+
+float dotProduct8(const float *a, const float *b, size_t n) {
+    return simdLevel() == SimdLevel::Avx2 ? dotProduct8Avx2(a, b, n) : dotProduct8Scalar(a, b, n);
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Fft.h"
+#include "ThreadPool.h"
+
+#define RESAMPLER_ZERO_CROSSINGS 16 // Sinc lobes kept on each side of the anti-aliasing filter's center
+#define RESAMPLER_KAISER_BETA 8.0 // Kaiser window shape; ~80 dB stopband attenuation
+#define RESAMPLER_ROLLOFF 0.92 // Passband edge as a fraction of the lower Nyquist frequency
+#define RESAMPLER_BLOCK_SIZE 4096 // Input samples staged per step, bounding the history buffer
+
+/**
+ * Rational (L/M) sample rate conversion with a polyphase windowed-sinc FIR filter. Conceptually the input is
+ * upsampled by L (zero stuffing), low pass filtered below the lower of the two Nyquist frequencies, and
+ * decimated by M; the polyphase form only ever evaluates the filter taps that meet non-zero inputs at the
+ * output samples that are kept, so anti-aliasing and decimation are one pass costing taps() multiply-adds per
+ * output sample.
+ *
+ * State carries over between calls, so a signal can be fed in chunks of any size and comes out identical to
+ * resampling it in one go. Output sample m lines up with input time m * M / L (the filter's delay is
+ * compensated), and a signal of n samples resamples to exactly ceil(n * L / M) samples once flushed.
+ *
+ * @tparam Real The sample and coefficient precision (float or double); the filter is designed in double either way.
+ */
+template <typename Real = sample_t>
+class PolyphaseResampler {
+public:
+    /**
+     * @param inputRate The sample rate of the input.
+     * @param outputRate The sample rate to produce. Equal (or non-positive) rates pass samples through untouched.
+     * @param zeroCrossings The half length of the filter in lobes of the sinc; longer is sharper but slower.
+     */
+    PolyphaseResampler(int inputRate, int outputRate, int zeroCrossings = RESAMPLER_ZERO_CROSSINGS);
+
+    /**
+     * Resample the next chunk of input.
+     *
+     * @param in The next input samples.
+     * @param count The number of input samples.
+     * @param out Receives the output samples completed by this chunk; must hold maxOutputFor(count).
+     * @return The number of output samples written.
+     */
+    size_t process(const Real *in, size_t count, Real *out);
+
+    /**
+     * Signal the end of the input, producing the last outputs (whose filter reaches past the end of the
+     * input, which is taken as silence).
+     *
+     * @param out Receives the remaining output samples; must hold maxOutputFor(0).
+     * @return The number of output samples written.
+     */
+    size_t flush(Real *out);
+
+    /**
+     * Compute outputs [first, first + count) of resampling a whole signal in one go, without the streaming state.
+     * Each output reads the input directly, so ranges can be computed in any order or in parallel, and they
+     * match process and flush bit for bit.
+     *
+     * @param in The whole input signal.
+     * @param numOfSamples The length of the input signal.
+     * @param first The first output to compute.
+     * @param count The number of outputs to compute.
+     * @param out Receives count outputs.
+     */
+    void processRange(const Real *in, size_t numOfSamples, size_t first, size_t count, Real *out) const;
+
+    // Clear all state to begin a new signal
+    void reset();
+
+    size_t maxOutputFor(size_t count) const { return (count + taps) * up / down + 2; }
+
+    /**
+     * @param numOfSamples A total input length.
+     * @return The total output length once that much input has been processed and flushed.
+     */
+    size_t outputLengthFor(size_t numOfSamples) const { return (numOfSamples * up + down - 1) / down; }
+
+    size_t upFactor() const { return up; }
+    size_t downFactor() const { return down; }
+    size_t numOfTaps() const { return taps; }
+
+private:
+    size_t up = 1; // L
+    size_t down = 1; // M
+    size_t taps = 0; // Filter taps per phase (a multiple of 8, for the dot product kernel)
+    bool passThrough = false;
+
+    // Phase p's taps stored back to front, so output = dot(phase p, the taps most recent inputs in order)
+    std::vector<Real> coefficients;
+
+    // Inputs still needed by upcoming outputs: history[0] is absolute input index historyStart
+    std::vector<Real> history;
+    long long historyStart = 0;
+
+    // Next output's position: newest input index it needs, and filter phase
+    long long nextInput = 0;
+    size_t nextPhase = 0;
+
+    size_t inputsSeen = 0; // Real input samples processed
+    size_t inputsBuffered = 0; // Real plus the silence appended by flush
+    size_t outputsMade = 0;
+
+    Real (*dot)(const Real *, const Real *, size_t) = nullptr; // Picked once for the running CPU
+
+    // Output 0 sits at the filter's center, so output m lines up with input time m * M / L rather than lagging it
+    size_t delay() const { return (taps * up - 1) / 2; }
+
+    void append(const Real *in, size_t count);
+    void appendSilence(size_t count); // In place, so flushing allocates nothing
+    size_t drain(Real *out, size_t limit);
+};
+
+/**
+ * Resample a whole signal in one go (see PolyphaseResampler).
+ *
+ * @param signal The signal to resample, replaced by the resampled signal of ceil(n * L / M) samples.
+ * @param sampleRate The original sample rate of signal.
+ * @param targetSampleRate The desired sample rate of signal.
+ * @param pool Threads to split the output across (see processRange), or nullptr to resample on the caller.
+ */
+template <typename Real>
+void resample(std::vector<Real> &signal, int sampleRate, int targetSampleRate, ThreadPool *pool = nullptr);
+
+/**
+ * The dot product of two arrays whose length is a multiple of 8, summed as 8 interleaved partial sums that are
+ * combined pairwise. AVX2 and scalar versions combine in exactly the same order, so they agree bit for bit.
+ */
+double dotProduct8(const double *a, const double *b, size_t n);
+double dotProduct8Scalar(const double *a, const double *b, size_t n);
+double dotProduct8Avx2(const double *a, const double *b, size_t n);
+float dotProduct8(const float *a, const float *b, size_t n);
+float dotProduct8Scalar(const float *a, const float *b, size_t n);
+float dotProduct8Avx2(const float *a, const float *b, size_t n);
@@ -0,0 +1,49 @@
+// Built with -mavx2 (see CMakeLists.txt); only reached once simdLevel() has confirmed AVX2 support.
+#include "Resampler.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+double dotProduct8Avx2(const double *a, const double *b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    for (size_t i = 0; i < n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    __m256d t = _mm256_add_pd(acc0, acc1);
+    __m128d u = _mm_add_pd(_mm256_castpd256_pd128(t), _mm256_extractf128_pd(t, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(u, _mm_unpackhi_pd(u, u)));
+}
+
+float dotProduct8Avx2(const float *a, const float *b, size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    __m128 t = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)); // Lanes k + (k + 4)
+    __m128 u = _mm_add_ps(t, _mm_movehl_ps(t, t)); // (t0 + t2, t1 + t3)
+    return _mm_cvtss_f32(_mm_add_ss(u, _mm_shuffle_ps(u, u, 1)));
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+double dotProduct8Avx2(const double *a, const double *b, size_t n) {
+    return dotProduct8Scalar(a, b, n);
+}
+
+float dotProduct8Avx2(const float *a, const float *b, size_t n) {
+    return dotProduct8Scalar(a, b, n);
+}
+
+#else
+
+// Never selected off x86; defined so the dispatch still links
+double dotProduct8Avx2(const double *a, const double *b, size_t n) {
+    return dotProduct8Scalar(a, b, n);
+}
+
+float dotProduct8Avx2(const float *a, const float *b, size_t n) {
+    return dotProduct8Scalar(a, b, n);
+}
+
+#endif
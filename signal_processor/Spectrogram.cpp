@@ -1,7 +1,15 @@
 #include "Spectrogram.h"
+#include "FixedFft.h"
+#include "Metrics.h"
+#include "Resampler.h"
+#include "StftWorkspace.h"
+#include "ThreadPool.h"
 #include <algorithm>
+#include <utility>
 
-void applyLowPassFilter(std::vector<double> &signal, int sampleRate, int cutoffFreq) {
+template <typename Real>
+void applyLowPassFilter(std::vector<Real> &signal, int sampleRate, int cutoffFreq) {
+    INTUNE_STAGE(Stage::Filter, signal.size());
     double rc = 1.0 / (2 * M_PI * cutoffFreq); // Time constant of analog RC low pass filter
     double dt = 1.0 / sampleRate; // Sampling period (time between samples)
     double alpha = dt / (rc + dt); // Filter coefficient
@@ -14,13 +22,14 @@ void applyLowPassFilter(std::vector<double> &signal, int sampleRate, int cutoffF
         } else {
             // Sum new part (current sample scaled by alpha) and old part (previous output scaled by alpha 
             // couterpart) to get the filtered output
-            signal[i] = signal[i] * alpha + prevOutput * (1 - alpha);
+            signal[i] = Real(signal[i] * alpha + prevOutput * (1 - alpha));
         }
         prevOutput = signal[i];
     }
 }
 
-void downsample(std::vector<double> &signal, int sampleRate, int targetSampleRate) {
+template <typename Real>
+void downsample(std::vector<Real> &signal, int sampleRate, int targetSampleRate) {
     if (sampleRate <= 0 || targetSampleRate <= 0) return; // Sample rates must be positive
     if (sampleRate <= targetSampleRate) return; // We need a lower target than original rate to DOWNsample
     
@@ -30,8 +39,9 @@ void downsample(std::vector<double> &signal, int sampleRate, int targetSampleRat
     int ratio = sampleRate / targetSampleRate;
     if (ratio <= 1) return;
 
+    INTUNE_STAGE(Stage::Downsample, signal.size());
     size_t n = signal.size(); 
-    std::vector<double> resampledSignal;
+    std::vector<Real> resampledSignal;
 
     // To resample signal, we will process it in ratio (recall from earlier) sized chunks of samples
     for (size_t i = 0; i < n; i += ratio) {
@@ -41,124 +51,152 @@ void downsample(std::vector<double> &signal, int sampleRate, int targetSampleRat
         // Use the average (to avoid aliasing) of the sample window to construct the resampled signal 
         for (size_t j = i; j < sampleEndIdx; j++) sum += signal[j];
         double sampleAvg = sum / (sampleEndIdx - i);
-        resampledSignal.push_back(sampleAvg);
+        resampledSignal.push_back(Real(sampleAvg));
     }
 
     signal = resampledSignal;
 }
 
-void applyWindowFunction(std::vector<double> &signal, WindowFunction window) {
-    // TODO: May find it interesting to implement rectangle, triangle .. later 
+template <typename Real>
+void applyWindowFunction(std::vector<Real> &signal, WindowFunction window) {
     size_t n = signal.size();
+    if (n < 2) return;
+    double last = double(n - 1);
     switch (window) {
         case Hamming:
             for (size_t i = 0; i < n; i++) {
-                signal[i] *= (.54 - .46 * std::cos(2 * M_PI * i / (n - 1)));
+                signal[i] *= Real(.54 - .46 * std::cos(2 * M_PI * i / last));
             }
             break;
         case Hanning:
+            // Like Hamming but tapering all the way to zero at the edges
+            for (size_t i = 0; i < n; i++) {
+                signal[i] *= Real(.5 - .5 * std::cos(2 * M_PI * i / last));
+            }
+            break;
         case Triangle:
+            // Rising linearly from zero at the edges to one in the middle
+            for (size_t i = 0; i < n; i++) {
+                signal[i] *= Real(1.0 - std::abs(2.0 * i / last - 1.0));
+            }
+            break;
         case Rectangle:
         default:
             break;
     }
 }
 
-spectrogram Spectrogram(std::vector<double> signal, int sampleRate) {
-    applyLowPassFilter(signal, sampleRate, sampleRate / DOWNSAMPLE_RATIO);
-    downsample(signal, sampleRate, sampleRate / DOWNSAMPLE_RATIO);
+template void applyLowPassFilter<float>(std::vector<float> &, int, int);
+template void applyLowPassFilter<double>(std::vector<double> &, int, int);
+template void downsample<float>(std::vector<float> &, int, int);
+template void downsample<double>(std::vector<double> &, int, int);
+template void applyWindowFunction<float>(std::vector<float> &, WindowFunction);
+template void applyWindowFunction<double>(std::vector<double> &, WindowFunction);
+
+namespace {
+
+// Transform frames [first, last) of signal into their rows of sgram, FFT_BATCH_WIDTH frames at a time
+template <typename Storage, typename Real>
+void transformFrames(const std::vector<Real> &signal, WindowFunction window, size_t first, size_t last,
+                     SpectrogramMatrix<Storage> &sgram, StftWorkspace<Real> &workspace) {
+    constexpr size_t numOfBins = Fft<FRAME_SIZE, Real>::numOfRealBins;
+    // Complex double cells can take the bins as they are made; anything else is reduced from a staging block
+    constexpr bool direct = std::is_same<typename Storage::value_type, std::complex<Real>>::value;
+
+    // Every frame lies within the signal, so frames are read in place rather than copied out
+    const Real *frames[FFT_BATCH_WIDTH];
+    std::complex<Real> *bins[FFT_BATCH_WIDTH];
+    for (size_t i = first; i < last; i += FFT_BATCH_WIDTH) {
+        size_t width = std::min<size_t>(FFT_BATCH_WIDTH, last - i);
+        for (size_t lane = 0; lane < width; lane++) {
+            frames[lane] = signal.data() + (i + lane) * HOP_SIZE;
+            // Complex bins land straight in their rows; any other storage goes through the staging block
+            if constexpr (direct) bins[lane] = sgram.row(i + lane);
+            else bins[lane] = workspace.staging(lane);
+        }
 
-    size_t n = signal.size();
-    int numOfWindows = signal.size() / (FRAME_SIZE - HOP_SIZE);
-    std::cerr << "Frames: " << numOfWindows << ", Frame size: " << FRAME_SIZE << "\n";
-    // spectrogram sgram = spectrogram(numOfWindows);
-    spectrogram sgram;
-    sgram.reserve(numOfWindows);
+        // After applying the window function to each time frame, use FFT to convert frames from time to 
+        // frequency domain resulting in the corresponding frequency bins for each time frame. The frames are
+        // real, so only the non-redundant bins (DC through Nyquist) are kept.
+        {
+            INTUNE_STAGE(Stage::Fft, width);
+            Fft<FRAME_SIZE, Real>::forwardRealBatch(frames, bins, width, workspace.window(window),
+                                                    workspace.batchRe(), workspace.batchIm());
+        }
+        if constexpr (!direct) {
+            INTUNE_STAGE(Stage::SpectrogramAssembly, width);
+            for (size_t lane = 0; lane < width; lane++) Storage::fromBins(bins[lane], sgram.row(i + lane), numOfBins);
+        }
+    }
+}
+
+// Spectrogram on pool, or serially on the caller if pool is nullptr
+template <typename Storage, typename Real>
+SpectrogramMatrix<Storage> spectrogramOn(std::vector<Real> signal, int sampleRate, ThreadPool *pool) {
+    // Anti-alias and change rate in one polyphase pass, computing only the samples that are kept
+    resample(signal, sampleRate, FINGERPRINT_SAMPLE_RATE, pool);
+
+    size_t numOfWindows = numOfFrames(signal.size());
+    SpectrogramMatrix<Storage> sgram;
+    {
+        INTUNE_STAGE(Stage::SpectrogramAssembly);
+        sgram = SpectrogramMatrix<Storage>(numOfWindows, Fft<FRAME_SIZE, Real>::numOfRealBins);
+    }
 
     // Perform Short Time Fourier Transform (STFT) by first splitting the signal into short overlapping 
-    // windows (frames) where each is a time slice of samples. 
-    for (int i = 0; i < numOfWindows; i++) {
-        int frameStart = i * HOP_SIZE;
-        int frameEnd = std::min(int(n), frameStart + FRAME_SIZE);
-        std::vector<double> frame(FRAME_SIZE);
-        std::copy(signal.begin() + frameStart, signal.begin() + frameEnd, frame.begin());
-
-        // After applying hamming window function to the time frame, use FFT to convert frame from time to 
-        // frequency domain resulting in the corresponding frequency bins for the time frame. 
-        applyWindowFunction(frame, Hamming);
-        sgram.push_back(FFT(frame));
-    } 
+    // windows (frames) where each is a time slice of samples. Frames are transformed FFT_BATCH_WIDTH at a
+    // time, one per SIMD lane, with window weights and scratch taken from a preallocated workspace.
+    if (!pool) {
+        StftWorkspace<Real> workspace;
+        transformFrames(signal, Hamming, 0, numOfWindows, sgram, workspace);
+        return sgram; // Spectrogram[time][freq]
+    }
+
+    // Chunks are whole batches, a few per worker so uneven progress evens out. A lane's bins never depend on the
+    // rest of its batch, so how frames are chunked and which worker takes a chunk cannot change the result.
+    // Each worker gets its own workspace, so the frame loop itself never allocates
+    std::vector<StftWorkspace<Real>> workspaces(pool->numOfWorkers());
+    // Workers carry on attributing their stages to the caller's file format and sample rate
+    [[maybe_unused]] uint32_t label = MetricsLabel::current();
+    size_t numOfChunks = 4 * pool->numOfWorkers();
+    size_t chunk = (numOfWindows + numOfChunks - 1) / numOfChunks;
+    chunk = (chunk + FFT_BATCH_WIDTH - 1) / FFT_BATCH_WIDTH * FFT_BATCH_WIDTH;
+    pool->parallelFor(numOfChunks, [&](size_t c, size_t worker) {
+        INTUNE_METRICS_LABEL(label);
+        size_t first = std::min(numOfWindows, c * chunk);
+        size_t last = std::min(numOfWindows, first + chunk);
+        transformFrames(signal, Hamming, first, last, sgram, workspaces[worker]);
+    });
 
     // Spectrogram[time][freq]
     return sgram;
 }
 
-void transpose(spectrogram &s) {
-    if (s.empty()) return; // Nothing to transpose
-    size_t X = s.size();
-    size_t Y = s[0].size();
-    spectrogram transposed(Y, complex_vector(X));
-
-    for (size_t x = 0; x < X; x++) {
-        for (size_t y = 0; y < Y; y++) {
-            transposed[y][x] = s[x][y];
-        }
-    }
+} // namespace
 
-    s = transposed;
+template <typename Storage, typename Real>
+SpectrogramMatrix<Storage> Spectrogram(std::vector<Real> signal, int sampleRate, ThreadPool &pool) {
+    return spectrogramOn<Storage>(std::move(signal), sampleRate, &pool);
 }
 
-void visualize(spectrogram &s) {
-    if (s.empty()) {
-        std::cerr << "Nothing to visualize.\n";
-        return; // Nothing to visualize
-    }
-    size_t F = s.size();
-    size_t T = s[0].size();
-
-    // Convert amplitudes to decibels which is logarithmic (more distributed visual) and matches how we 
-    // actually perceive loudness
-    decibel_map dB(F, std::vector<double>(T));
-    double minDB = 1e9;
-    double maxDB = -1e9;
-    for (size_t f = 0; f < F; f++) {
-        for (size_t t = 0; t < T; t++) {
-            double magnitude = std::abs(s[f][t]) / FRAME_SIZE; // Magnitude of complex amplitude (strength of frequency at time)
-            magnitude = 20.0 * std::log10(std::max(magnitude, 1e-10)); // Complex amplitude to dB conversion
-            dB[f][t] = magnitude;
-            minDB = std::min(minDB, magnitude);
-            maxDB = std::max(maxDB, magnitude);
-        }
-    }
-
-    const double dynamicRange = 80.0;
-    for (auto &row : dB) {
-        for (auto &col : row) {
-            col = std::max(col, maxDB - dynamicRange);
-        }
-    }
-
-    // Represent decibel map as RGB pixels to create the "heat map" aspect
-    cv::Mat img(F, T, CV_8UC1); // 8U = 8 bit pixel (0 - 255), C1 = grayscale (first channel)
-    for (size_t f = 0; f < F; f++) {
-        for (size_t t = 0; t < T; t++) {
-            // Scale pixel brightness to be 0 <= b <= 1 for clear relative intensity
-            double brightness = (dB[f][t] - minDB) / (maxDB - minDB);
-            
-            // Safeguards
-            if (brightness > 1.0) brightness = 1.0; 
-            if (brightness < 0.0) brightness = 0.0;
-
-            // Transform pixel to RGB but flip image vertically to neutralize drawing rows backwards (an OpenCV thing)
-            img.at<uint8_t>(F - 1 - f, t) = static_cast<uint8_t>(brightness * 255.0);
-        }
-    }
+template <typename Storage, typename Real>
+SpectrogramMatrix<Storage> Spectrogram(std::vector<Real> signal, int sampleRate, size_t threads) {
+    if (threads == 0) threads = ThreadPool::defaultThreads() + 1;
+    if (threads == 1) return spectrogramOn<Storage>(std::move(signal), sampleRate, nullptr);
+    ThreadPool pool(threads - 1);
+    return spectrogramOn<Storage>(std::move(signal), sampleRate, &pool);
+}
 
-    // TODO: I may consider file output as an option; add output type as a specification parameter.
-    // cv::rotate(img, img, cv::ROTATE_180_CLOCKWISE);
-    cv::applyColorMap(img, img, cv::COLORMAP_MAGMA);
-    cv::namedWindow("Spectrogram", cv::WINDOW_NORMAL);
-    // cv::resizeWindow("Spectrogram", T * 2, F * 2);
-    cv::imshow("Spectrogram", img);
-    cv::waitKey(0); // Pauses program until any key press
-}
\ No newline at end of file
+template SpectrogramMatrix<ComplexStorage> Spectrogram<ComplexStorage>(std::vector<float>, int, size_t);
+template SpectrogramMatrix<MagnitudeStorage> Spectrogram<MagnitudeStorage>(std::vector<float>, int, size_t);
+template SpectrogramMatrix<LogMagnitudeStorage> Spectrogram<LogMagnitudeStorage>(std::vector<float>, int, size_t);
+template SpectrogramMatrix<ComplexStorage> Spectrogram<ComplexStorage>(std::vector<double>, int, size_t);
+template SpectrogramMatrix<MagnitudeStorage> Spectrogram<MagnitudeStorage>(std::vector<double>, int, size_t);
+template SpectrogramMatrix<LogMagnitudeStorage> Spectrogram<LogMagnitudeStorage>(std::vector<double>, int, size_t);
+template SpectrogramMatrix<ComplexStorage> Spectrogram<ComplexStorage>(std::vector<float>, int, ThreadPool &);
+template SpectrogramMatrix<MagnitudeStorage> Spectrogram<MagnitudeStorage>(std::vector<float>, int, ThreadPool &);
+template SpectrogramMatrix<LogMagnitudeStorage> Spectrogram<LogMagnitudeStorage>(std::vector<float>, int, ThreadPool &);
+template SpectrogramMatrix<ComplexStorage> Spectrogram<ComplexStorage>(std::vector<double>, int, ThreadPool &);
+template SpectrogramMatrix<MagnitudeStorage> Spectrogram<MagnitudeStorage>(std::vector<double>, int, ThreadPool &);
+template SpectrogramMatrix<LogMagnitudeStorage> Spectrogram<LogMagnitudeStorage>(std::vector<double>, int,
+                                                                                   ThreadPool &);
@@ -1,14 +1,16 @@
+#pragma once
 #include <vector>
 #include "Fft.h"
-#include <opencv2/opencv.hpp>
+#include "SpectrogramMatrix.h"
+#include "ThreadPool.h"
 
-using spectrogram = std::vector<std::vector<complex_number>>;
-using decibel_map = std::vector<std::vector<double>>;
+using spectrogram = SpectrogramMatrix<MagnitudeStorage>;
 
 #define MAX_FREQUENCY 5000 // 5 kHz
 #define DOWNSAMPLE_RATIO 4 // Reduce sample to 1/4 of its original sample rate
+#define FINGERPRINT_SAMPLE_RATE (44100 / DOWNSAMPLE_RATIO) // Every signal is resampled to this rate (11.025 kHz)
 #define FRAME_SIZE 1024 // Number of samples in each (STFT) window
-#define HOP_SIZE FRAME_SIZE / 32 // Sample overlap between adjacent windows
+#define HOP_SIZE (FRAME_SIZE / 32) // Samples between the starts of adjacent windows
 
 // Types of different window functions used in signal windowing
 enum WindowFunction {
@@ -18,6 +20,17 @@ enum WindowFunction {
     Hamming,
 };
 
+/**
+ * The number of whole STFT frames that fit in a signal: frame i covers samples [i * HOP_SIZE, i * HOP_SIZE +
+ * FRAME_SIZE), and only frames lying entirely within the signal are produced.
+ *
+ * @param numOfSamples The length of the (downsampled) signal.
+ * @return The number of frames Spectrogram (or StreamingStft) produces for that many samples.
+ */
+inline size_t numOfFrames(size_t numOfSamples) {
+    return numOfSamples < FRAME_SIZE ? 0 : 1 + (numOfSamples - FRAME_SIZE) / HOP_SIZE;
+}
+
 /**
  * This first order low pass filter attentuates frequencies of a signal above the specified 
  * cutoff frequency.
@@ -26,7 +39,8 @@ enum WindowFunction {
  * @param sampleRate The sample rate of signal.
  * @param cutoffFreq The frequency at which to attentuate higher frequencies.
  */
-void applyLowPassFilter(std::vector<double> &signal, int sampleRate, int cutoffFreq);
+template <typename Real>
+void applyLowPassFilter(std::vector<Real> &signal, int sampleRate, int cutoffFreq);
 
 /**
  * Downsampling (decimation) will reduce the sample rate of a signal by keeping a fraction of the 
@@ -36,49 +50,64 @@ void applyLowPassFilter(std::vector<double> &signal, int sampleRate, int cutoffF
  * @param sampleRate The original sample rate of signal.
  * @param targetSampleRate The desired sample rate of signal.
  */
-void downsample(std::vector<double> &signal, int sampleRate, int targetSampleRate);
+template <typename Real>
+void downsample(std::vector<Real> &signal, int sampleRate, int targetSampleRate);
 
 /**
  * Multiply a signal by a specified window function to avoid spectral leakage and taper a signal to
  * zero at the edges. If not specified, a rectangle window function will be applied to the signal.
+ * Every call evaluates the window afresh; per frame loops should use the tables of an StftWorkspace.
  * 
  * @param signal The signal to be windowed.
  * @param windowType The window function to be applied on signal.
  */
-void applyWindowFunction(std::vector<double> &signal, WindowFunction window = Rectangle);
+template <typename Real>
+void applyWindowFunction(std::vector<Real> &signal, WindowFunction window = Rectangle);
 
 /**
  * This creates a spectrogram; a visual representation of a signal as a function of time, frequency, and
  * amplitude.
  * 
+ * @tparam Storage What each cell keeps: ComplexStorage (complex amplitude), MagnitudeStorage (the default)
+ * or LogMagnitudeStorage (decibels).
+ * @tparam Real The precision the signal is resampled and transformed in, taken from signal: float (sample_t,
+ * what production runs) or double (the reference).
  * @param signal The signal the spectrogram will derive from.
- * @param sampleRate The sample rate of signal.
+ * @param sampleRate The sample rate of signal. Any rate works: signal is first resampled to
+ * FINGERPRINT_SAMPLE_RATE, so frames and bins mean the same time and frequency whatever the source rate.
+ * @param pool The pool to resample and transform on (e.g. for hours long recordings), the caller working alongside
+ * it. The frame range is split into chunks of whole FFT batches, each written straight into its own rows by a
+ * worker with its own scratch; every frame is computed exactly as the serial path would, so the result is bit for
+ * bit the same for any number of workers.
  * @return A spectrogram where each row corresponds to a time frame and each column within that row is a
- * frequency bin: spectrogram[time = i][frequency = k] = complex amplitude representing the magnitude and phase 
- * of frequency bin k at time i in the signal.
+ * frequency bin: spectrogram(time = i, frequency = k) = the (Storage reduced) complex amplitude of frequency
+ * bin k at time i in the signal. Only the FRAME_SIZE / 2 + 1 non-redundant bins are stored.
  * 
  * @note For computation and analysis sake, it makes sense for the spectrogram to be indexed [time][frequency].
- * However, when graphing or plotting the spectrogram, make sure to transpose it to be indexed [frequency][time]
- * as it is conventionally oriented.
+ * However, when graphing or plotting the spectrogram, use view().transposed() to index it [frequency][time]
+ * as it is conventionally oriented; the transposed view shares the same cells rather than copying them.
  */
-spectrogram Spectrogram(std::vector<double> signal, int sampleRate);
+template <typename Storage = MagnitudeStorage, typename Real = sample_t>
+SpectrogramMatrix<Storage> Spectrogram(std::vector<Real> signal, int sampleRate, ThreadPool &pool);
 
 /**
- * Transposing a spectrogram results in the indexing switching from [time][frequency] to [frequency][time] or
- * vice versa depending on the structure of s initially. The values at indices are still respective complex
- * amplitudes.
- * 
- * @param s The spectrogram to be tranposed.
- * 
- * @note Transposing a matrix twice returns it to its original configuration. The same holds for spectrograms!
+ * Spectrogram on a pool of its own, started and joined by this call. Callers making many spectrograms should
+ * keep one ThreadPool and pass it instead.
+ *
+ * @param threads The number of threads to run on, the caller included: 1 runs serially on the caller, 0 runs on
+ * one per hardware thread.
  */
-void transpose(spectrogram &s);
+template <typename Storage = MagnitudeStorage, typename Real = sample_t>
+SpectrogramMatrix<Storage> Spectrogram(std::vector<Real> signal, int sampleRate, size_t threads = 1);
 
 /**
  * Visualize a spectrogram as a frequency over time "heat map" plot.
  * 
- * @param s The spectrogram to be visualized.
+ * @param s A view of the magnitudes to be visualized.
+ * @param decibels True if the cells are already in decibels (LogMagnitudeStorage) rather than magnitudes.
  * 
- * @note It is assumed the spectrogram is conventionally indexed: [frequency][time].
+ * @note It is assumed the view is conventionally indexed: [frequency][time]. Opens an OpenCV window, so it is
+ * only built into the interactive executable (see Visualize.cpp), not the intune library; headless code renders
+ * to image files with renderSpectrogram and renderTilePyramid (see Render.h).
  */
-void visualize(spectrogram &s);
\ No newline at end of file
+void visualize(SpectrogramView<const float> s, bool decibels = false);
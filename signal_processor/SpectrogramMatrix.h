@@ -0,0 +1,235 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#define SPECTROGRAM_ALIGNMENT 64 // Bytes; rows start on cache line (and AVX-512 vector) boundaries
+
+/*---------Storage policies----------*/
+// Each policy picks the element type kept per (frame, bin) cell and how a complex FFT bin (of either precision)
+// is reduced to it. Reductions run in the precision of the bins.
+
+// Full complex amplitude (magnitude and phase), 16 bytes per cell
+struct ComplexStorage {
+    using value_type = std::complex<double>;
+
+    template <typename Real>
+    static void fromBins(const std::complex<Real> *bins, value_type *out, size_t n) {
+        std::copy(bins, bins + n, out);
+    }
+};
+
+// Magnitude only, as float32, 4 bytes per cell
+struct MagnitudeStorage {
+    using value_type = float;
+
+    template <typename Real>
+    static void fromBins(const std::complex<Real> *bins, value_type *out, size_t n) {
+        // sqrt(re^2 + im^2) rather than std::abs, which goes through the (much slower) overflow safe hypot
+        for (size_t k = 0; k < n; k++) {
+            Real re = bins[k].real();
+            Real im = bins[k].imag();
+            out[k] = float(std::sqrt(re * re + im * im));
+        }
+    }
+};
+
+// Magnitude in decibels, 20 * log10(|bin|) floored at MIN_MAGNITUDE, as float32, 4 bytes per cell
+struct LogMagnitudeStorage {
+    using value_type = float;
+    static constexpr double MIN_MAGNITUDE = 1e-10;
+
+    template <typename Real>
+    static void fromBins(const std::complex<Real> *bins, value_type *out, size_t n) {
+        const Real floor = Real(MIN_MAGNITUDE * MIN_MAGNITUDE);
+        for (size_t k = 0; k < n; k++) {
+            Real re = bins[k].real();
+            Real im = bins[k].imag();
+            // 10 * log10(|bin|^2) == 20 * log10(|bin|) without the square root
+            out[k] = float(Real(10) * std::log10(std::max(re * re + im * im, floor)));
+        }
+    }
+};
+
+/*---------Fast decibels----------*/
+
+/**
+ * 20 * log10(x), floored at LogMagnitudeStorage::MIN_MAGNITUDE like it, from the exponent and mantissa bits of x:
+ * ln(m) = 2 * atanh((m - 1) / (m + 1)) with the exponent chosen so m lies within [sqrt(1/2), sqrt(2)), where four
+ * terms of the series are exact to float precision (within 4e-5 dB). Only integer and float arithmetic, no
+ * branches, so loops over it vectorize, unlike calls to std::log10.
+ */
+inline float fastDecibels(float x) {
+    // Floored on the bits, which order like the values for positive floats (and negative ones are below every
+    // positive one); a float comparison would stop the loop vectorizing under strict floating point
+    const float floor = float(LogMagnitudeStorage::MIN_MAGNITUDE);
+    int32_t bits;
+    int32_t floorBits;
+    std::memcpy(&bits, &x, 4);
+    std::memcpy(&floorBits, &floor, 4);
+    bits = bits < floorBits ? floorBits : bits;
+    int32_t exponent = (bits - 0x3F3504F3) >> 23; // 0x3F3504F3 is sqrt(1/2)
+    bits -= exponent * (1 << 23);
+    float m;
+    std::memcpy(&m, &bits, 4); // x / 2^exponent
+
+    float z = (m - 1.0f) / (m + 1.0f);
+    float z2 = z * z;
+    float ln = 2.0f * z * (1.0f + z2 * (1.0f / 3 + z2 * (1.0f / 5 + z2 * (1.0f / 7))));
+    return 8.68588964f * (float(exponent) * 0.693147181f + ln); // 20 / ln(10) * ln(x)
+}
+
+/**
+ * Convert magnitudes to decibels with fastDecibels, for rendering, caching and anything else that converts many
+ * cells at once.
+ *
+ * @param magnitudes The n magnitudes to convert.
+ * @param out Receives the n decibel values; may be magnitudes itself.
+ * @param n The number of values.
+ */
+inline void magnitudesToDecibels(const float *magnitudes, float *out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = fastDecibels(magnitudes[i]);
+}
+
+/**
+ * A non-owning, strided 2D window onto spectrogram cells: element (r, c) lives at data[r * rowStride +
+ * c * colStride]. Swapping the strides transposes the view and a negative stride flips it, so neither
+ * copies any data.
+ *
+ * @note A view of a SpectrogramMatrix starts out indexed [time][frequency]; transposed() gives the
+ * conventional [frequency][time] orientation for plotting.
+ */
+template <typename T>
+class SpectrogramView {
+public:
+    SpectrogramView() = default;
+    SpectrogramView(T *data, size_t rows, size_t cols, ptrdiff_t rowStride, ptrdiff_t colStride)
+        : data(data), numOfRows(rows), numOfCols(cols), rowStride(rowStride), colStride(colStride) {}
+
+    // Views of mutable cells convert to views of const cells, never the other way around
+    template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+    SpectrogramView(const SpectrogramView<U> &other)
+        : SpectrogramView(other.ptr(), other.rows(), other.cols(), other.strideOfRows(), other.strideOfCols()) {}
+
+    size_t rows() const { return numOfRows; }
+    size_t cols() const { return numOfCols; }
+    bool empty() const { return numOfRows == 0 || numOfCols == 0; }
+    ptrdiff_t strideOfRows() const { return rowStride; }
+    ptrdiff_t strideOfCols() const { return colStride; }
+    T *ptr() const { return data; }
+
+    T &operator()(size_t r, size_t c) const { return data[ptrdiff_t(r) * rowStride + ptrdiff_t(c) * colStride]; }
+
+    // True when each row is a plain array, so row(r) can be handed to loops that expect contiguous data
+    bool hasContiguousRows() const { return colStride == 1; }
+    T *row(size_t r) const { return data + ptrdiff_t(r) * rowStride; }
+
+    SpectrogramView transposed() const { return {data, numOfCols, numOfRows, colStride, rowStride}; }
+
+    // Mirror the row order (e.g. so frequency increases upwards when rows are drawn top to bottom)
+    SpectrogramView flippedRows() const {
+        if (numOfRows == 0) return *this;
+        return {row(numOfRows - 1), numOfRows, numOfCols, -rowStride, colStride};
+    }
+
+    SpectrogramView subview(size_t row, size_t rowCount, size_t col, size_t colCount) const {
+        return {&(*this)(row, col), rowCount, colCount, rowStride, colStride};
+    }
+
+private:
+    T *data = nullptr;
+    size_t numOfRows = 0;
+    size_t numOfCols = 0;
+    ptrdiff_t rowStride = 0;
+    ptrdiff_t colStride = 0;
+};
+
+/**
+ * Copy every cell of src into dst (same shape) in square tiles, so that when one side is transposed both
+ * the reads and the writes stay within a few cache lines per tile instead of striding across the matrix.
+ *
+ * @param src The cells to copy.
+ * @param dst Where to copy them; must have the same rows and cols as src.
+ */
+template <typename T, typename U>
+void copyBlocked(SpectrogramView<T> src, SpectrogramView<U> dst) {
+    const size_t tile = 32;
+    for (size_t r0 = 0; r0 < src.rows(); r0 += tile) {
+        size_t r1 = std::min(src.rows(), r0 + tile);
+        for (size_t c0 = 0; c0 < src.cols(); c0 += tile) {
+            size_t c1 = std::min(src.cols(), c0 + tile);
+            for (size_t r = r0; r < r1; r++) {
+                for (size_t c = c0; c < c1; c++) dst(r, c) = src(r, c);
+            }
+        }
+    }
+}
+
+/**
+ * A spectrogram held in one contiguous, SPECTROGRAM_ALIGNMENT aligned buffer indexed [time][frequency]. Each
+ * row (frame) is padded to a whole number of alignment units so every row starts aligned, and the element
+ * type is chosen by the Storage policy (complex, magnitude or log-magnitude).
+ *
+ * @note Only real signal spectra are stored, so a row holds the FRAME_SIZE / 2 + 1 non-redundant bins.
+ */
+template <typename Storage>
+class SpectrogramMatrix {
+public:
+    using value_type = typename Storage::value_type;
+
+    SpectrogramMatrix() = default;
+    SpectrogramMatrix(size_t frames, size_t bins) : frames(frames), bins(bins) {
+        constexpr size_t perUnit = std::max<size_t>(1, SPECTROGRAM_ALIGNMENT / sizeof(value_type));
+        stride = (bins + perUnit - 1) / perUnit * perUnit;
+        if (frames * stride > 0) {
+            cells = static_cast<value_type *>(
+                ::operator new(frames * stride * sizeof(value_type), std::align_val_t(SPECTROGRAM_ALIGNMENT)));
+            std::fill(cells, cells + frames * stride, value_type());
+        }
+    }
+    ~SpectrogramMatrix() { release(); }
+
+    SpectrogramMatrix(const SpectrogramMatrix &) = delete;
+    SpectrogramMatrix &operator=(const SpectrogramMatrix &) = delete;
+    SpectrogramMatrix(SpectrogramMatrix &&other) noexcept { *this = std::move(other); }
+    SpectrogramMatrix &operator=(SpectrogramMatrix &&other) noexcept {
+        if (this != &other) {
+            release();
+            cells = std::exchange(other.cells, nullptr);
+            frames = std::exchange(other.frames, 0);
+            bins = std::exchange(other.bins, 0);
+            stride = std::exchange(other.stride, 0);
+        }
+        return *this;
+    }
+
+    size_t numOfFrames() const { return frames; }
+    size_t numOfBins() const { return bins; }
+    size_t rowStride() const { return stride; }
+    bool empty() const { return frames == 0 || bins == 0; }
+
+    value_type *row(size_t frame) { return cells + frame * stride; }
+    const value_type *row(size_t frame) const { return cells + frame * stride; }
+    value_type &operator()(size_t frame, size_t bin) { return cells[frame * stride + bin]; }
+    const value_type &operator()(size_t frame, size_t bin) const { return cells[frame * stride + bin]; }
+
+    SpectrogramView<value_type> view() { return {cells, frames, bins, ptrdiff_t(stride), 1}; }
+    SpectrogramView<const value_type> view() const { return {cells, frames, bins, ptrdiff_t(stride), 1}; }
+
+private:
+    value_type *cells = nullptr;
+    size_t frames = 0;
+    size_t bins = 0;
+    size_t stride = 0; // Elements between the starts of consecutive rows
+
+    void release() {
+        if (cells) ::operator delete(cells, std::align_val_t(SPECTROGRAM_ALIGNMENT));
+        cells = nullptr;
+    }
+};
@@ -0,0 +1,16 @@
+#include "StftWorkspace.h"
+#include "FixedFft.h"
+
+template <typename Real>
+StftWorkspace<Real>::StftWorkspace()
+    : re(FFT_BATCH_WIDTH * FRAME_SIZE / 2), im(FFT_BATCH_WIDTH * FRAME_SIZE / 2),
+      stage(FFT_BATCH_WIDTH * Fft<FRAME_SIZE, Real>::numOfRealBins), frameSamples(FRAME_SIZE),
+      frameBins(Fft<FRAME_SIZE, Real>::numOfRealBins) {
+    for (int function = 0; function < NUM_OF_WINDOW_FUNCTIONS; function++) {
+        windows[function].assign(FRAME_SIZE, Real(1));
+        applyWindowFunction(windows[function], WindowFunction(function));
+    }
+}
+
+template class StftWorkspace<float>;
+template class StftWorkspace<double>;
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "Fft.h"
+#include "Spectrogram.h"
+
+#define NUM_OF_WINDOW_FUNCTIONS 4 // Entries of WindowFunction
+
+/**
+ * Everything an STFT needs per frame, allocated once up front: a FRAME_SIZE table of weights for every
+ * WindowFunction, scratch for the batched FFT, a staging block for bins on their way to a storage policy, and a
+ * single frame buffer and bin buffer for frame at a time transforms. Transforming frames through a workspace
+ * makes no heap allocations at all, so one is kept per worker (or per stream) and reused for every frame.
+ *
+ * @tparam Real The precision of the frames and bins (see sample_t).
+ * @note Not thread safe; give each thread its own.
+ */
+template <typename Real = sample_t>
+class StftWorkspace {
+public:
+    StftWorkspace();
+
+    // FRAME_SIZE weights of a window function
+    const Real *window(WindowFunction function) const { return windows[function].data(); }
+
+    // FFT_BATCH_WIDTH * FRAME_SIZE / 2 values each, for Fft<FRAME_SIZE, Real>::forwardRealBatch
+    Real *batchRe() { return re.data(); }
+    Real *batchIm() { return im.data(); }
+
+    // FRAME_SIZE / 2 + 1 bins for each of FFT_BATCH_WIDTH lanes
+    std::complex<Real> *staging(size_t lane) { return stage.data() + lane * (FRAME_SIZE / 2 + 1); }
+
+    // One frame of FRAME_SIZE samples and its FRAME_SIZE / 2 + 1 bins
+    Real *frame() { return frameSamples.data(); }
+    std::complex<Real> *bins() { return frameBins.data(); }
+
+private:
+    std::vector<Real> windows[NUM_OF_WINDOW_FUNCTIONS];
+    std::vector<Real> re;
+    std::vector<Real> im;
+    std::vector<std::complex<Real>> stage;
+    std::vector<Real> frameSamples;
+    std::vector<std::complex<Real>> frameBins;
+};
@@ -0,0 +1,129 @@
+#include "StreamingStft.h"
+#include "FixedFft.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <type_traits>
+
+template <typename Real>
+StreamingStft<Real>::StreamingStft(int sampleRate, FrameCallback onFrame, WindowFunction window)
+    : onFrame(std::move(onFrame)), sampleRate(sampleRate), resampler(sampleRate, FINGERPRINT_SAMPLE_RATE),
+      staged(RESAMPLER_BLOCK_SIZE), resampled(resampler.maxOutputFor(RESAMPLER_BLOCK_SIZE)), ring(FRAME_SIZE),
+      window(window) {}
+
+template <typename Real>
+void StreamingStft<Real>::push(const float *samples, size_t count) {
+    pushSamples(samples, count);
+}
+
+template <typename Real>
+void StreamingStft<Real>::push(const double *samples, size_t count) {
+    pushSamples(samples, count);
+}
+
+template <typename Real>
+template <typename T>
+void StreamingStft<Real>::pushSamples(const T *samples, size_t count) {
+    // Block by block so the resampler's output always fits in resampled, however large the push
+    for (size_t i = 0; i < count; i += RESAMPLER_BLOCK_SIZE) {
+        size_t block = std::min<size_t>(RESAMPLER_BLOCK_SIZE, count - i);
+        const Real *in;
+        if constexpr (std::is_same<T, Real>::value) {
+            in = samples + i;
+        } else {
+            std::copy(samples + i, samples + i + block, staged.begin());
+            in = staged.data();
+        }
+        size_t produced;
+        {
+            INTUNE_STAGE(Stage::Resample, block);
+            produced = resampler.process(in, block, resampled.data());
+        }
+        pushResampled(resampled.data(), produced);
+    }
+}
+
+template <typename Real>
+void StreamingStft<Real>::flush() {
+    size_t produced;
+    {
+        INTUNE_STAGE(Stage::Resample);
+        produced = resampler.flush(resampled.data());
+    }
+    pushResampled(resampled.data(), produced);
+}
+
+template <typename Real>
+void StreamingStft<Real>::reset(int newSampleRate) {
+    if (newSampleRate != sampleRate) {
+        sampleRate = newSampleRate;
+        resampler = PolyphaseResampler<Real>(sampleRate, FINGERPRINT_SAMPLE_RATE);
+        resampled.resize(resampler.maxOutputFor(RESAMPLER_BLOCK_SIZE));
+    } else {
+        resampler.reset();
+    }
+    std::fill(ring.begin(), ring.end(), Real(0));
+    ringPos = 0;
+    untilNextFrame = FRAME_SIZE;
+    frameIndex = 0;
+}
+
+template <typename Real>
+void StreamingStft<Real>::pushResampled(const Real *samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        ring[ringPos] = samples[i];
+        ringPos = (ringPos + 1) % FRAME_SIZE;
+        if (--untilNextFrame == 0) {
+            emitFrame();
+            untilNextFrame = HOP_SIZE;
+        }
+    }
+}
+
+template <typename Real>
+void StreamingStft<Real>::emitFrame() {
+    {
+        // The oldest sample sits at ringPos (the next slot to be overwritten), so unroll the ring from there
+        INTUNE_STAGE(Stage::Fft, 1);
+        Real *frame = workspace.frame();
+        auto oldest = ring.begin() + ringPos;
+        std::copy(ring.begin(), oldest, std::copy(oldest, ring.end(), frame));
+        const Real *weights = workspace.window(window);
+        for (size_t i = 0; i < FRAME_SIZE; i++) frame[i] *= weights[i];
+
+        Fft<FRAME_SIZE, Real>::forwardReal(frame, workspace.bins());
+    }
+    onFrame(frameIndex++, workspace.bins());
+}
+
+template class StreamingStft<float>;
+template class StreamingStft<double>;
+
+template <typename Storage, typename Real>
+SpectrogramMatrix<Storage> Spectrogram(const MappedWavFile &file, size_t blockFrames) {
+    INTUNE_METRICS_LABEL(pcmFormat(file.header.audioFormat, file.header.bitsPerSample), file.header.sampleRate);
+    SpectrogramMatrix<Storage> sgram;
+    StreamingStft<Real> stft(file.header.sampleRate, [&](size_t frame, const std::complex<Real> *bins) {
+        INTUNE_STAGE(Stage::SpectrogramAssembly, 1);
+        Storage::fromBins(bins, sgram.row(frame), sgram.numOfBins());
+    });
+    {
+        INTUNE_STAGE(Stage::SpectrogramAssembly);
+        sgram = SpectrogramMatrix<Storage>(stft.framesFor(file.numOfFrames()), Fft<FRAME_SIZE, Real>::numOfRealBins);
+    }
+
+    std::vector<float> block(blockFrames);
+    for (size_t offset = 0; offset < file.numOfFrames(); offset += blockFrames) {
+        size_t read = file.readFrames(offset, blockFrames, block.data());
+        stft.push(block.data(), read);
+    }
+    stft.flush();
+    return sgram;
+}
+
+template SpectrogramMatrix<ComplexStorage> Spectrogram<ComplexStorage, float>(const MappedWavFile &, size_t);
+template SpectrogramMatrix<MagnitudeStorage> Spectrogram<MagnitudeStorage, float>(const MappedWavFile &, size_t);
+template SpectrogramMatrix<LogMagnitudeStorage> Spectrogram<LogMagnitudeStorage, float>(const MappedWavFile &, size_t);
+template SpectrogramMatrix<ComplexStorage> Spectrogram<ComplexStorage, double>(const MappedWavFile &, size_t);
+template SpectrogramMatrix<MagnitudeStorage> Spectrogram<MagnitudeStorage, double>(const MappedWavFile &, size_t);
+template SpectrogramMatrix<LogMagnitudeStorage> Spectrogram<LogMagnitudeStorage, double>(const MappedWavFile &,
+                                                                                        size_t);
@@ -0,0 +1,111 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "Resampler.h"
+#include "Spectrogram.h"
+#include "StftWorkspace.h"
+#include "Wav.h"
+
+/**
+ * A Short Time Fourier Transform over a signal that arrives in pieces (a file read block by block, stdin, a
+ * microphone pipe, ...). Samples go through the same resampling to FINGERPRINT_SAMPLE_RATE as Spectrogram, but
+ * with the resampler's state carried between pushes, into a ring buffer holding the last FRAME_SIZE samples. Every
+ * HOP_SIZE samples a frame is complete and is handed to the callback straight away, so latency is about one
+ * frame and memory stays bounded by FRAME_SIZE no matter how long the stream runs.
+ *
+ * @tparam Real The precision samples are resampled and transformed in (see sample_t).
+ * @note Frame i covers the same (resampled) samples as row i of Spectrogram, so for the same input (and Real) the
+ * frames match it bin for bin.
+ */
+template <typename Real = sample_t>
+class StreamingStft {
+public:
+    /**
+     * Called once per completed frame, in order.
+     *
+     * @param frame The index of the frame (0, 1, 2, ...).
+     * @param bins The FRAME_SIZE / 2 + 1 complex frequency bins of the frame. Only valid during the call.
+     */
+    using FrameCallback = std::function<void(size_t frame, const std::complex<Real> *bins)>;
+
+    /**
+     * @param sampleRate The sample rate of the pushed samples.
+     * @param onFrame Receives every completed frame.
+     * @param window The window function applied to every frame.
+     */
+    StreamingStft(int sampleRate, FrameCallback onFrame, WindowFunction window = Hamming);
+
+    /**
+     * Feed the next chunk of samples. Any number of samples may be pushed at a time; frames completed by
+     * them are emitted before this returns.
+     *
+     * @param samples The next samples of the signal (mono).
+     * @param count The number of samples.
+     */
+    void push(const float *samples, size_t count);
+    void push(const double *samples, size_t count);
+
+    /**
+     * Signal the end of the stream. The resampler's last outputs (whose filter reaches past the end of the
+     * input) are produced like resample does, which may complete one last frame.
+     */
+    void flush();
+
+    /**
+     * Start a new stream, keeping the window tables and buffers (e.g. a worker moving on to the next file). The
+     * resampler's filter is only redesigned if the sample rate changes.
+     *
+     * @param sampleRate The sample rate of the new stream.
+     */
+    void reset(int sampleRate);
+
+    size_t framesEmitted() const { return frameIndex; }
+    int outputSampleRate() const {
+        return int(int64_t(sampleRate) * resampler.upFactor() / resampler.downFactor());
+    }
+
+    /**
+     * @param numOfSamples The number of samples that will be pushed in total (then flushed).
+     * @return The number of frames those samples will produce.
+     */
+    size_t framesFor(size_t numOfSamples) const { return numOfFrames(resampler.outputLengthFor(numOfSamples)); }
+
+private:
+    FrameCallback onFrame;
+    int sampleRate;
+
+    // Pushed samples of the other precision are converted into staged, RESAMPLER_BLOCK_SIZE at a time, and
+    // resampled into resampled
+    PolyphaseResampler<Real> resampler;
+    std::vector<Real> staged;
+    std::vector<Real> resampled;
+
+    // The last FRAME_SIZE resampled samples. Frames start every HOP_SIZE samples and FRAME_SIZE is a whole
+    // number of hops, so a frame always starts at a hop boundary of the ring.
+    std::vector<Real> ring;
+    size_t ringPos = 0;
+    size_t untilNextFrame = FRAME_SIZE;
+    size_t frameIndex = 0;
+
+    // Window table and frame buffers; after construction no push allocates
+    StftWorkspace<Real> workspace;
+    WindowFunction window;
+
+    template <typename T>
+    void pushSamples(const T *samples, size_t count);
+    void pushResampled(const Real *samples, size_t count);
+    void emitFrame();
+};
+
+/**
+ * Build a spectrogram from a mapped .wav file by decoding it block by block into a StreamingStft, so the
+ * only full length allocation is the spectrogram itself (no audio copy, no full length signal).
+ *
+ * @tparam Storage What each cell keeps (see Spectrogram).
+ * @tparam Real The precision to transform in (see sample_t).
+ * @param file The mapped .wav file; all channels are averaged to mono.
+ * @param blockFrames The number of sample frames decoded per block.
+ * @return The same spectrogram Spectrogram(file's signal, sampleRate) produces.
+ */
+template <typename Storage = MagnitudeStorage, typename Real = sample_t>
+SpectrogramMatrix<Storage> Spectrogram(const MappedWavFile &file, size_t blockFrames = 1 << 16);
@@ -0,0 +1,142 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+
+// The pool and worker index of the calling thread, if it is a pool thread, so submit can find its own deque
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t numOfThreads) : queues(numOfThreads) {
+    threads.reserve(numOfThreads);
+    for (size_t i = 0; i < numOfThreads; i++) threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : threads) t.join();
+}
+
+size_t ThreadPool::defaultThreads() {
+    size_t hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 0;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t task, size_t worker)> &fn) {
+    if (count == 0) return;
+    std::lock_guard<std::mutex> call(callMutex);
+    if (threads.empty() || count == 1) {
+        for (size_t task = 0; task < count; task++) fn(task, threads.size());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        nextTask.store(0, std::memory_order_relaxed);
+        busyWorkers = threads.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks(threads.size());
+
+    // Tasks are all claimed once the caller runs out, but pool threads may still be finishing theirs
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::submit(std::function<void(size_t worker)> task) {
+    if (threads.empty()) {
+        task(threads.size());
+        return;
+    }
+
+    size_t target = currentPool == this ? currentWorker
+                                        : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[target].mutex);
+        queues[target].tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queuedTasks++;
+        unfinishedTasks++;
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [&] { return unfinishedTasks == 0; });
+}
+
+bool ThreadPool::takeTask(size_t worker, std::function<void(size_t)> &task) {
+    // Own queue from the back, then everyone else's from the front
+    for (size_t i = 0; i < queues.size(); i++) {
+        TaskQueue &queue = queues[(worker + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t worker) {
+    currentPool = this;
+    currentWorker = worker;
+    size_t seen = 0;
+    std::function<void(size_t)> task;
+    while (true) {
+        bool loop = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen || queuedTasks > 0; });
+            if (stopping) return;
+            if (generation != seen) {
+                seen = generation;
+                loop = true;
+            } else {
+                queuedTasks--; // Reserve one queued task; it is in some deque until taken below
+            }
+        }
+
+        if (loop) {
+            runTasks(worker);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0) finished.notify_one();
+            continue;
+        }
+
+        // Every reservation is backed by a task pushed before it was counted, so this finds one at the latest
+        // once other reserving threads have taken theirs
+        while (!takeTask(worker, task)) std::this_thread::yield();
+        task(worker);
+        task = nullptr;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--unfinishedTasks == 0) drained.notify_all();
+    }
+}
+
+void ThreadPool::runTasks(size_t worker) {
+    while (true) {
+        size_t task = nextTask.fetch_add(1, std::memory_order_relaxed);
+        if (task >= jobCount) return;
+        (*job)(task, worker);
+    }
+}
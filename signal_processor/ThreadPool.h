@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads, for fork/join loops and for streams of independent tasks.
+ *
+ * parallelFor hands out task indices one at a time from a shared counter, so uneven tasks balance themselves,
+ * and the calling thread works alongside the pool rather than sleeping until it finishes.
+ *
+ * submit queues tasks for the pool threads in one deque per thread. Tasks submitted from outside the pool are dealt
+ * to the deques round robin; a task submitted by a pool thread goes on that thread's own deque. Each thread runs
+ * its own deque newest first (so follow-up work a task submits runs while what it touched is likely still in
+ * cache) and, when it runs dry, steals the oldest task of another thread. The deques only spread out storing and
+ * handing over tasks: one central count of queued and unfinished tasks, behind a single mutex, lets idle threads
+ * sleep and wait() block, so every submit and every finished task still takes that mutex once.
+ *
+ * @note Every task is given the index of the worker running it (0 to numOfWorkers() - 1, the caller being the
+ * last), so callers can keep per worker state, e.g. one scratch buffer or histogram per worker, without locks.
+ * Tasks must not call parallelFor on the pool running them, since it waits for every pool thread.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param numOfThreads Threads to start besides the caller; 0 runs everything on the caller.
+     */
+    explicit ThreadPool(size_t numOfThreads = defaultThreads());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Pool threads plus the caller
+    size_t numOfWorkers() const { return threads.size() + 1; }
+
+    /**
+     * Run fn(task, worker) for every task in [0, count) and wait for all of them. Only one parallelFor runs on a
+     * pool at a time; concurrent callers queue up.
+     *
+     * @param count The number of tasks.
+     * @param fn The work of one task.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t task, size_t worker)> &fn);
+
+    /**
+     * Queue a task for the pool threads; returns straight away. Called from a pool thread, the task goes on that
+     * thread's own deque. With no pool threads the task runs on the caller before this returns.
+     *
+     * @param task The work, given the index of the worker running it.
+     */
+    void submit(std::function<void(size_t worker)> task);
+
+    // Wait until every submitted task has finished
+    void wait();
+
+    // One thread per hardware thread, less the caller
+    static size_t defaultThreads();
+
+private:
+    std::vector<std::thread> threads;
+
+    std::mutex callMutex; // Serializes parallelFor calls
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    bool stopping = false;
+    size_t generation = 0; // Bumped for every parallelFor, so sleeping workers know there is new work
+
+    // The current loop
+    const std::function<void(size_t, size_t)> *job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextTask{0};
+    size_t busyWorkers = 0;
+
+    // Submitted tasks: one deque per pool thread, each behind its own lock
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void(size_t)>> tasks;
+    };
+    std::vector<TaskQueue> queues;
+    std::atomic<size_t> nextQueue{0}; // Round robin target for tasks submitted from outside the pool
+    size_t queuedTasks = 0; // Submitted but not yet started (guarded by mutex)
+    size_t unfinishedTasks = 0; // Submitted but not yet finished (guarded by mutex)
+    std::condition_variable drained;
+
+    void workerLoop(size_t worker);
+    void runTasks(size_t worker);
+    bool takeTask(size_t worker, std::function<void(size_t)> &task);
+};
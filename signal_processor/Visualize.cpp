@@ -0,0 +1,26 @@
+// The only OpenCV dependent code; built into the interactive SignalProcessor executable, not the library
+#include "Render.h"
+#include "Spectrogram.h"
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+void visualize(SpectrogramView<const float> s, bool decibels) {
+    if (s.empty()) {
+        std::cerr << "Nothing to visualize.\n";
+        return; // Nothing to visualize
+    }
+
+    // Render headlessly (pooled down to at most RENDER_WIDTH x RENDER_HEIGHT, so long tracks stay quick) and only
+    // hand the finished pixels to OpenCV, which wants them BGR
+    RenderParams params;
+    params.decibels = decibels;
+    Image image = renderSpectrogram(s, params);
+    cv::Mat rgb(int(image.height), int(image.width), CV_8UC3, image.rgb.data());
+    cv::Mat img;
+    cv::cvtColor(rgb, img, cv::COLOR_RGB2BGR);
+
+    cv::namedWindow("Spectrogram", cv::WINDOW_NORMAL);
+    // cv::resizeWindow("Spectrogram", T * 2, F * 2);
+    cv::imshow("Spectrogram", img);
+    cv::waitKey(0); // Pauses program until any key press
+}
@@ -1,6 +1,10 @@
 #include "Wav.h"
+#include "Metrics.h"
+#include "PcmDecode.h"
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <algorithm>
 
 WavFile::WavFile(std::string file) {
     valid = load(file);
@@ -13,6 +17,7 @@ WavFile::WavFile(std::string file) {
  * @return True if and only if all WavFile fields have been properly generated from the given .wav.
  */
 bool WavFile::load(std::string filePath) {
+    INTUNE_STAGE(Stage::WavLoad);
     std::ifstream file(filePath, std::ios::binary);
     if (!file) {
         std::cerr << "Failed to open file: " << filePath << "\n";
@@ -25,6 +30,12 @@ bool WavFile::load(std::string filePath) {
         return false;
     }
 
+    // The real format of WAVE_FORMAT_EXTENSIBLE files is the start of the SubFormat GUID in the fmt extension
+    if (header.audioFormat == WAVE_FORMAT_EXTENSIBLE && header.subchunk1Size >= EXTENSIBLE_SUBFORMAT_OFFSET + 2) {
+        file.seekg(START_OF_FMT_DATA + EXTENSIBLE_SUBFORMAT_OFFSET);
+        file.read(reinterpret_cast<char*>(&header.audioFormat), 2);
+    }
+
     // Parse over non standard (but valid) wav formats including LIST + INFO ...
     if (std::strncmp(header.subchunk2Id, "data", FOURCC_LENGTH) != 0) {
         file.seekg(START_OF_FMT_DATA + header.subchunk1Size); // After fmt chunk
@@ -38,78 +49,152 @@ bool WavFile::load(std::string filePath) {
                 header.subchunk2Size = chunkSize;
                 break;
             }
-            file.seekg(chunkSize, std::ios::cur); // File ptr set to current + chunkSize
+            file.seekg(chunkSize + (chunkSize & 1), std::ios::cur); // File ptr set to current + chunkSize (+ pad byte)
         }
     }
 
     // Rest of file is actual audio, so read it!
     audioData.resize(header.subchunk2Size);
     file.read(reinterpret_cast<char*>(audioData.data()), header.subchunk2Size);
+    INTUNE_STAGE_ITEMS(audioData.size());
     return true;
 }   
 
 /**
  * Extract normalized PCM signal from WavFile audio data
  * 
+ * @tparam Real The sample precision: float (sample_t) or double.
  * @param convertToMono True if we would like to handle all number of channels as a singular channel (mono).
  * @return The normalized PCM signal [-1, 1] of the respective WavFile audio data
  */
-std::vector<double> WavFile::extractSignal(bool convertToMono) {
-    size_t bytesPerSample = header.bitsPerSample / 8;
-    size_t numSamples = header.subchunk2Size / (header.numChannels * bytesPerSample);
+template <typename Real>
+std::vector<Real> WavFile::extractSignal(bool convertToMono) {
+    PcmFormat format = pcmFormat(header.audioFormat, header.bitsPerSample);
+    if (format == PcmFormat::Unsupported || header.numChannels == 0) return {};
+
+    size_t bytesPerSample = pcmBytesPerSample(format);
+    size_t numSamples = audioData.size() / (header.numChannels * bytesPerSample);
     size_t outputSize;
     if (convertToMono) outputSize = numSamples;
     else outputSize = numSamples * header.numChannels;
-    std::vector<double> signal(outputSize);
-
-    for (size_t i = 0; i < numSamples; i++) {
-        double monoSum = 0;
-        for (int ch = 0; ch < header.numChannels; ch++) {
-            size_t byteIdx = (i * header.numChannels + ch) * bytesPerSample;
-            double sample = 0;
-
-            switch (header.bitsPerSample) {
-                case 8: {
-                    uint8_t val = audioData[byteIdx];
-                    sample = (val - 128) / 128.0; // 2^8 / 2
-                    break;
-                }
-                case 12: {
-                    int16_t val;
-                    std::memcpy(&val, &audioData[byteIdx], 2); // 16 / 8
-                    sample = val / 32768.0; // 2^16 / 2
-                    break;
-                }
-                case 24: {
-                    int32_t val = 0;
-                    std::memcpy(&val, &audioData[byteIdx], 3); // 24 / 8
-                    if (val & 0x800000) val |= 0xFF000000;
-                    sample = val / 8388608.0; // 2^24 / 2
-                    break;
-                }
-                case 32: {
-                    if (header.audioFormat == 3) { // IEEE float
-                        float val;
-                        std::memcpy(&val, &audioData[byteIdx], 4); // 24 / 8
-                        sample = val;
-                    } else { // PCM int
-                        int64_t val;
-                        std::memcpy(&val, &audioData[byteIdx], 4); // 16 / 8
-                        sample = val / 2147483648.0; // 2^32 / 2
-                    }
-                    break;
-                }
-                default:
-                    break;
-            }
+    std::vector<Real> signal(outputSize);
+
+    INTUNE_METRICS_LABEL(format, header.sampleRate);
+    INTUNE_STAGE(Stage::Decode, numSamples);
+    decodePcm(format, audioData.data(), numSamples, header.numChannels, signal.data(), convertToMono);
+    return signal;
+}
+
+template std::vector<float> WavFile::extractSignal<float>(bool);
+template std::vector<double> WavFile::extractSignal<double>(bool);
+
+namespace {
+
+uint16_t readU16(const uint8_t *p) {
+    uint16_t v;
+    std::memcpy(&v, p, 2);
+    return v;
+}
+
+uint32_t readU32(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+} // namespace
+
+MappedWavFile::MappedWavFile(std::string file) {
+    valid = load(file);
+}
+
+/**
+ * Map a .wav file and locate its fmt and data chunks in place.
+ * 
+ * @param filePath The file path of the .wav file to map.
+ * @return True if and only if the file is a RIFF/WAVE file with a supported format and a data chunk.
+ */
+bool MappedWavFile::load(std::string filePath) {
+    INTUNE_STAGE(Stage::WavLoad);
+    valid = false;
+    audio = nullptr;
+    audioSize = 0;
+    if (!file.open(filePath, true)) return false;
 
-            if (convertToMono && header.numChannels > 1) monoSum += sample;
-            else signal[i * header.numChannels + ch] = sample;
+    const uint8_t *bytes = file.data();
+    size_t size = file.size();
+    INTUNE_STAGE_ITEMS(size);
+    if (size < RIFF_HEADER_SIZE || std::memcmp(bytes, "RIFF", FOURCC_LENGTH) != 0 ||
+        std::memcmp(bytes + 8, "WAVE", FOURCC_LENGTH) != 0) {
+        std::cerr << "Not a valid .wav file.\n";
+        return false;
+    }
+    std::memcpy(header.chunkId, bytes, FOURCC_LENGTH);
+    header.chunkSize = readU32(bytes + 4);
+    std::memcpy(header.format, bytes + 8, FOURCC_LENGTH);
+
+    // Walk the chunk list; every chunk is (id, size, payload padded to an even length)
+    bool foundFmt = false;
+    size_t pos = RIFF_HEADER_SIZE;
+    while (pos + CHUNK_HEADER_SIZE <= size) {
+        const uint8_t *chunk = bytes + pos;
+        size_t chunkSize = readU32(chunk + 4);
+        size_t payload = pos + CHUNK_HEADER_SIZE;
+        size_t available = size - payload;
+
+        if (std::memcmp(chunk, "fmt ", FOURCC_LENGTH) == 0) {
+            if (chunkSize < 16 || chunkSize > available) break;
+            const uint8_t *fmt = bytes + payload;
+            std::memcpy(header.subchunk1Id, chunk, FOURCC_LENGTH);
+            header.subchunk1Size = uint32_t(chunkSize);
+            header.audioFormat = readU16(fmt);
+            header.numChannels = readU16(fmt + 2);
+            header.sampleRate = readU32(fmt + 4);
+            header.byteRate = readU32(fmt + 8);
+            header.blockAlign = readU16(fmt + 12);
+            header.bitsPerSample = readU16(fmt + 14);
+            if (header.audioFormat == WAVE_FORMAT_EXTENSIBLE && chunkSize >= EXTENSIBLE_SUBFORMAT_OFFSET + 2) {
+                header.audioFormat = readU16(fmt + EXTENSIBLE_SUBFORMAT_OFFSET);
+            }
+            foundFmt = true;
+        } else if (std::memcmp(chunk, "data", FOURCC_LENGTH) == 0) {
+            if (!foundFmt) break;
+            // Recorders that were cut off often leave the size unpatched, so trust the file length over it
+            std::memcpy(header.subchunk2Id, chunk, FOURCC_LENGTH);
+            header.subchunk2Size = uint32_t(std::min(chunkSize, available));
+            audio = bytes + payload;
+            audioSize = header.subchunk2Size;
+            break;
         }
+        if (chunkSize > available) break;
+        pos = payload + chunkSize + (chunkSize & 1);
+    }
 
-        if (convertToMono && header.numChannels > 1) signal[i] = monoSum / header.numChannels;
+    if (!foundFmt || !audio) {
+        std::cerr << "Missing fmt or data chunk in .wav file.\n";
+        return false;
     }
+    format = pcmFormat(header.audioFormat, header.bitsPerSample);
+    if (format == PcmFormat::Unsupported || header.numChannels == 0 ||
+        header.blockAlign != header.numChannels * pcmBytesPerSample(format)) {
+        std::cerr << "Unsupported .wav sample format (" << header.audioFormat << ", " << header.bitsPerSample
+                  << " bits, " << header.numChannels << " channels).\n";
+        return false;
+    }
+    return true;
+}
 
-    return signal;
+size_t MappedWavFile::numOfFrames() const {
+    return header.blockAlign ? audioSize / header.blockAlign : 0;
 }
 
+size_t MappedWavFile::readFrames(size_t offset, size_t count, float *out, bool convertToMono) const {
+    if (!valid) return 0;
+    size_t total = numOfFrames();
+    if (offset >= total) return 0;
+    count = std::min(count, total - offset);
+
+    INTUNE_STAGE(Stage::Decode, count);
+    decodePcm(format, audio + offset * header.blockAlign, count, header.numChannels, out, convertToMono);
+    return count;
+}
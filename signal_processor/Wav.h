@@ -1,9 +1,21 @@
+#pragma once
 #include <cstdint>
 #include <string>
 #include <vector>
+#include "Fft.h"
+#include "MappedFile.h"
+#include "PcmDecode.h"
 
 #define FOURCC_LENGTH 4 // Four character code
 #define START_OF_FMT_DATA 20 // In bytes
+#define RIFF_HEADER_SIZE 12 // "RIFF", chunk size, "WAVE"
+#define CHUNK_HEADER_SIZE 8 // Chunk id + chunk size
+
+// Format codes found in the fmt chunk (audioFormat)
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IEEE_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE // Real format code is the first 2 bytes of the SubFormat GUID
+#define EXTENSIBLE_SUBFORMAT_OFFSET 24 // Offset of SubFormat within the fmt chunk
 
 // .WAV file header struct
 struct WavHeader {
@@ -33,10 +45,54 @@ public:
     WavFile(std::string file);
 
     bool load(std::string file);
-    std::vector<double> extractSignal(bool convertToMono = true);
+    template <typename Real = sample_t>
+    std::vector<Real> extractSignal(bool convertToMono = true);
     operator bool() { return valid; }
 
 private:
     std::vector<uint8_t> audioData;
     bool valid;
-};
\ No newline at end of file
+};
+
+/**
+ * A .wav file read in place through a memory mapping instead of being copied into memory. The RIFF chunks are
+ * walked (with bounds checks) directly in the mapping, and audio is decoded on demand a block of frames at a
+ * time, so any length of file costs constant memory beyond what the page cache holds.
+ */
+class MappedWavFile {
+public:
+    WavHeader header; // Filled from the fmt and data chunks; audioFormat has WAVE_FORMAT_EXTENSIBLE resolved
+
+    MappedWavFile(std::string file);
+
+    bool load(std::string file);
+
+    /**
+     * @return The number of sample frames (one sample per channel) in the data chunk.
+     */
+    size_t numOfFrames() const;
+
+    /**
+     * Decode a block of sample frames straight out of the mapping into normalized [-1, 1] samples.
+     *
+     * @param offset The first sample frame to read.
+     * @param count The number of sample frames to read.
+     * @param out Receives count samples when convertToMono, otherwise count * numChannels interleaved samples.
+     * @param convertToMono True to average all channels of a frame into one sample.
+     * @return The number of sample frames read, fewer than count at the end of the data.
+     */
+    size_t readFrames(size_t offset, size_t count, float *out, bool convertToMono = true) const;
+
+    // The undecoded bytes of the data chunk, straight out of the mapping (e.g. to hash the audio)
+    const uint8_t *data() const { return audio; }
+    size_t dataSize() const { return audioSize; }
+
+    operator bool() { return valid; }
+
+private:
+    MappedFile file;
+    const uint8_t *audio = nullptr;
+    size_t audioSize = 0;
+    PcmFormat format = PcmFormat::Unsupported;
+    bool valid = false;
+};
@@ -0,0 +1,68 @@
+// The hot loops make no heap allocations once warmed up (see StftWorkspace and AllocationCounter.h)
+#include "AllocationCounter.h"
+#include "Check.h"
+#include "StreamingStft.h"
+#include "Synthetic.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+#define ALLOCATION_WARMUP_SECONDS 1.0 // Pushed before counting, so first use allocations are not counted
+#define ALLOCATION_SONG_SECONDS 10.0
+#define ALLOCATION_BLOCK_SIZE 4096 // Samples pushed at a time, like a decode block
+
+namespace {
+
+// Push signal[first, last) a block at a time
+template <typename Real>
+void pushBlocks(StreamingStft<Real> &stft, const std::vector<float> &signal, size_t first, size_t last) {
+    for (size_t i = first; i < last; i += ALLOCATION_BLOCK_SIZE) {
+        stft.push(signal.data() + i, std::min<size_t>(ALLOCATION_BLOCK_SIZE, last - i));
+    }
+}
+
+// Steady state pushes of a StreamingStft<Real> allocate nothing, and neither does a whole second stream after a
+// reset (as ingest workers do between files), which must reproduce the first stream exactly
+template <typename Real>
+void checkStreamingStft(const std::vector<float> &signal, size_t warmup) {
+    size_t frames = 0;
+    double checksum = 0.0;
+    StreamingStft<Real> stft(SYNTHETIC_SAMPLE_RATE, [&](size_t, const std::complex<Real> *bins) {
+        frames++;
+        for (size_t k = 0; k < FRAME_SIZE / 2 + 1; k++) checksum += std::abs(bins[k]);
+    });
+    pushBlocks(stft, signal, 0, warmup);
+
+    size_t before = threadAllocations();
+    pushBlocks(stft, signal, warmup, signal.size());
+    stft.flush();
+    size_t allocations = threadAllocations() - before;
+    std::cerr << "  StreamingStft<" << (sizeof(Real) == sizeof(float) ? "float" : "double") << ">: " << frames
+              << " frames, " << allocations << " allocations after warm up";
+    CHECK(frames > 0);
+    CHECK(allocations == 0);
+
+    size_t firstFrames = std::exchange(frames, 0);
+    double firstChecksum = std::exchange(checksum, 0.0);
+    before = threadAllocations();
+    stft.reset(SYNTHETIC_SAMPLE_RATE);
+    pushBlocks(stft, signal, 0, signal.size());
+    stft.flush();
+    allocations = threadAllocations() - before;
+    std::cerr << ", " << allocations << " for a second stream after reset\n";
+    CHECK(allocations == 0);
+    CHECK(frames == firstFrames);
+    CHECK(checksum == firstChecksum);
+}
+
+} // namespace
+
+void checkAllocations() {
+    if (!CHECK(allocationCountingEnabled())) return; // Every count would be 0, so nothing would be checked
+
+    std::vector<float> signal = syntheticSong(3, ALLOCATION_SONG_SECONDS);
+    size_t warmup = size_t(ALLOCATION_WARMUP_SECONDS * SYNTHETIC_SAMPLE_RATE);
+    checkStreamingStft<float>(signal, warmup);
+    checkStreamingStft<double>(signal, warmup);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * A minimal check harness for intune_check: CHECK reports a failed condition (with its source location) and
+ * counts it, but carries on, so one run shows every failure. intune_check exits non-zero if any check failed.
+ */
+#define CHECK(condition) checkThat(bool(condition), #condition, __FILE__, __LINE__)
+
+bool checkThat(bool ok, const char *expression, const char *file, int line);
+size_t checkFailures();
+
+// The checks, each run by name (see tests/main.cpp)
+void checkPrecision();
+void checkAllocations();
+void checkPcm();
+void checkPeaks();
+void checkIndex();
+void checkMatcher();
+void checkHash();
@@ -0,0 +1,55 @@
+// contentHash against reference XXH64 digests, so cache keys never silently change: every input length class
+// (the 32 byte stripe loop, then 8, 4 and 1 byte tails), with and without a seed, aligned or not
+#include "Check.h"
+#include "FingerprintCache.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct ReferenceDigest {
+    size_t length; // Of the bytes (i * 7 + 3) & 0xFF
+    uint64_t unseeded;
+    uint64_t seeded; // With seed 0x9E3779B97F4A7C15
+};
+
+// From the reference implementation (xxHash 0.8)
+const ReferenceDigest DIGESTS[] = {
+    {0, 0xEF46DB3751D8E999, 0xC4349FC93C010000},
+    {1, 0x1F25C8D0BC1F4BB6, 0x79826BCD749D267A},
+    {3, 0x31D2363F52E564C9, 0x78EFD77575E26575},
+    {4, 0x9BB64B7D66EE9FDA, 0x6F0A6C97D68BF353},
+    {7, 0x9A7B149959CE60D8, 0xD97EDE93C9D66A0D},
+    {8, 0xDAB99D95C6F90092, 0xA2F1E28437A78A1B},
+    {15, 0x1B47CB8243CC8E32, 0xE2EC50A544FAEC61},
+    {16, 0x434850232B787BE2, 0x93351859A7286376},
+    {31, 0xA2AA5F33CC4A6119, 0x755437271D1D0A84},
+    {32, 0x23C3C17EF790FD97, 0xBF624B932C090428},
+    {33, 0x50A7CFC7BA588784, 0x7ACEAF1E9D34EA35},
+    {63, 0x5E3E54B431C7493C, 0x2C8DDCE5C85D0D9D},
+    {64, 0x0EB64B3EF6EEB01F, 0x4AF341F14E3A6FC9},
+    {100, 0xA61F8D4C170FE531, 0xF6D8F65C625ABB4F},
+    {255, 0x39AE55A29989206F, 0x8310FF6A20CADFAD},
+    {256, 0x00CFC5207DD8E201, 0x05DA853CBD232C06},
+};
+
+} // namespace
+
+void checkHash() {
+    CHECK(contentHash("", 0) == 0xEF46DB3751D8E999);
+    CHECK(contentHash("", 0, 1) == 0xD5AFBA1336A3BE4B);
+    CHECK(contentHash("a", 1) == 0xD24EC4F1A98C6E5B);
+    CHECK(contentHash("abc", 3) == 0x44BC2CF5AD770999);
+
+    std::vector<uint8_t> bytes(256);
+    for (size_t i = 0; i < bytes.size(); i++) bytes[i] = uint8_t(i * 7 + 3);
+    std::vector<uint8_t> shifted(bytes.size() + 1);
+    for (const ReferenceDigest &digest : DIGESTS) {
+        std::memcpy(shifted.data() + 1, bytes.data(), digest.length); // Odd address: loads must not assume alignment
+        bool ok = CHECK(contentHash(bytes.data(), digest.length) == digest.unseeded);
+        ok = CHECK(contentHash(shifted.data() + 1, digest.length) == digest.unseeded) && ok;
+        ok = CHECK(contentHash(bytes.data(), digest.length, 0x9E3779B97F4A7C15) == digest.seeded) && ok;
+        if (!ok) std::cerr << "  length " << digest.length << "\n";
+    }
+}
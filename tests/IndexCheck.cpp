@@ -0,0 +1,202 @@
+// FingerprintIndex: lookups return exactly the postings added, before and after a save and open round trip, and
+// opening rejects corrupted files instead of reading out of bounds
+#include "Check.h"
+#include "FingerprintIndex.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+#define INDEX_CHECK_SONGS 60
+#define INDEX_CHECK_HASHES 5000 // Distinct hashes songs draw from, few enough that most are shared
+#define INDEX_CHECK_CORRUPTIONS 2000 // Randomly corrupted files opened (and, if accepted, read)
+
+namespace {
+
+using Expected = std::map<uint32_t, std::vector<Posting>>;
+
+bool lookupMatches(const FingerprintIndex &index, uint32_t hash, const std::vector<Posting> &expected) {
+    PostingList list = index.lookup(hash);
+    Posting posting;
+    size_t i = 0;
+    while (list.next(posting)) {
+        if (i == expected.size() || posting.songId != expected[i].songId) return false;
+        if (posting.anchorFrame != expected[i].anchorFrame) return false;
+        i++;
+    }
+    return i == expected.size();
+}
+
+void checkLookups(const FingerprintIndex &index, const Expected &expected, size_t postings) {
+    if (!CHECK(index)) return;
+    CHECK(index.numOfKeys() == expected.size());
+    CHECK(index.numOfPostings() == postings);
+    CHECK(index.numOfSongs() == INDEX_CHECK_SONGS);
+    size_t wrong = 0;
+    for (const auto &[hash, list] : expected) wrong += !lookupMatches(index, hash, list);
+    CHECK(wrong == 0);
+
+    // Hashes that were never added: past the largest key, and in the gaps after each of the first few
+    size_t gaps = 0;
+    for (auto it = expected.begin(); it != expected.end() && gaps < 100; ++it, gaps++) {
+        if (!expected.count(it->first + 1)) CHECK(index.lookup(it->first + 1).empty());
+    }
+    if (!expected.count(0xFFFFFFFF)) CHECK(index.lookup(0xFFFFFFFF).empty());
+}
+
+// Fingerprints of random songs over a shared pool of hashes (spread over the whole hash range, so every directory
+// prefix is used), with repeats of a hash within a song as in real music
+Expected addSongs(FingerprintIndexBuilder &builder, size_t &postings) {
+    std::mt19937 random(10);
+    std::vector<uint32_t> pool(INDEX_CHECK_HASHES);
+    for (uint32_t &hash : pool) hash = uint32_t(random());
+    pool.push_back(0); // The smallest hash (first key of the first prefix)
+
+    Expected expected;
+    postings = 0;
+    for (uint32_t song = INDEX_CHECK_SONGS; song-- > 0;) { // Any order of songs works
+        std::vector<fingerprint> fingerprints;
+        size_t count = 100 + random() % 2000;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t hash = pool[random() % pool.size()];
+            uint32_t frame = uint32_t(random() % 20000);
+            fingerprints.push_back(makeFingerprint(hash, frame));
+        }
+        std::sort(fingerprints.begin(), fingerprints.end());
+        fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()), fingerprints.end());
+        std::shuffle(fingerprints.begin(), fingerprints.end(), random);
+        builder.add(song, fingerprints);
+        for (fingerprint f : fingerprints) expected[fingerprintHash(f)].push_back({song, fingerprintFrame(f)});
+        postings += fingerprints.size();
+    }
+    for (auto &[hash, list] : expected) {
+        std::sort(list.begin(), list.end(), [](const Posting &a, const Posting &b) {
+            return a.songId != b.songId ? a.songId < b.songId : a.anchorFrame < b.anchorFrame;
+        });
+    }
+    return expected;
+}
+
+std::vector<char> readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), {});
+}
+
+bool opens(const std::string &path, const std::vector<char> &bytes) {
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), std::streamsize(bytes.size()));
+    }
+    std::streambuf *errors = std::cerr.rdbuf(nullptr); // Rejections are expected here; keep the output readable
+    FingerprintIndex index;
+    bool ok = index.open(path);
+    std::cerr.rdbuf(errors);
+    return ok;
+}
+
+template <typename T>
+void poke(std::vector<char> &bytes, size_t offset, T value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T peek(const std::vector<char> &bytes, size_t offset) {
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+}
+
+size_t aligned(size_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+// Damage each section in a way open must notice, then flip random bits and read whatever is still accepted
+void checkCorruption(const std::string &path, const std::vector<char> &good, const Expected &expected) {
+    FingerprintIndexHeader h = peek<FingerprintIndexHeader>(good, 0);
+    size_t prefixes = size_t(1) << h.directoryBits;
+    size_t directory = aligned(sizeof(FingerprintIndexHeader));
+    size_t bases = aligned(directory + (prefixes + 1) * sizeof(uint32_t));
+    size_t keys = aligned(bases + (prefixes + 1) * sizeof(uint64_t));
+    size_t offsets = aligned(keys + h.numOfKeys * sizeof(uint32_t));
+    size_t metadataEnd = offsets + h.numOfKeys * sizeof(uint32_t);
+
+    CHECK(opens(path, good));
+    std::vector<char> bad = good;
+    bad[0] ^= 1;
+    CHECK(!opens(path, bad));
+    bad = good;
+    poke<uint32_t>(bad, offsetof(FingerprintIndexHeader, version), FINGERPRINT_INDEX_VERSION + 1);
+    CHECK(!opens(path, bad));
+    bad = std::vector<char>(good.begin(), good.end() - 1);
+    CHECK(!opens(path, bad));
+    bad = good;
+    poke<uint32_t>(bad, directory + prefixes * sizeof(uint32_t), uint32_t(h.numOfKeys + 1));
+    CHECK(!opens(path, bad));
+    bad = good;
+    poke<uint32_t>(bad, directory + prefixes / 2 * sizeof(uint32_t), uint32_t(h.numOfKeys));
+    CHECK(!opens(path, bad));
+    bad = good;
+    poke<uint64_t>(bad, bases + prefixes * sizeof(uint64_t), h.postingBytes - 1);
+    CHECK(!opens(path, bad));
+    bad = good;
+    poke<uint32_t>(bad, keys + sizeof(uint32_t), peek<uint32_t>(good, keys)); // A repeated key
+    CHECK(!opens(path, bad));
+    bad = good;
+    poke<uint32_t>(bad, offsets + sizeof(uint32_t), 0xFFFFFFFF); // An offset past its prefix's postings
+    CHECK(!opens(path, bad));
+
+    std::mt19937 random(11);
+    size_t accepted = 0, postingsRead = 0;
+    for (size_t trial = 0; trial < INDEX_CHECK_CORRUPTIONS; trial++) {
+        bad = good;
+        for (size_t flips = 1 + random() % 4; flips > 0; flips--) {
+            bad[random() % metadataEnd] ^= char(1 << random() % 8);
+        }
+        if (!opens(path, bad)) continue;
+        accepted++;
+
+        // Whatever open lets through must be safe to read (a read out of bounds crashes the check)
+        FingerprintIndex index;
+        index.open(path);
+        for (const auto &[hash, list] : expected) {
+            PostingList postingList = index.lookup(hash);
+            Posting posting;
+            while (postingList.next(posting)) postingsRead++;
+        }
+    }
+    std::cerr << "  corrupted files accepted: " << accepted << " of " << INDEX_CHECK_CORRUPTIONS << " ("
+              << postingsRead << " postings read from them)\n";
+}
+
+} // namespace
+
+void checkIndex() {
+    FingerprintIndexBuilder builder;
+    size_t postings = 0;
+    Expected expected = addSongs(builder, postings);
+    FingerprintIndex built = builder.build();
+    checkLookups(built, expected, postings);
+    CHECK(builder.numOfPostings() == 0);
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() /
+                                      ("intune_check_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(directory);
+    std::string path = (directory / "index.bin").string();
+    if (CHECK(built.save(path))) {
+        CHECK(std::distance(std::filesystem::directory_iterator(directory), {}) == 1); // No temporary file left
+        FingerprintIndex opened;
+        if (CHECK(opened.open(path))) {
+            checkLookups(opened, expected, postings);
+            CHECK(opened.sizeInBytes() == built.sizeInBytes());
+        }
+        checkCorruption((directory / "bad.bin").string(), readFile(path), expected);
+    }
+    std::filesystem::remove_all(directory);
+}
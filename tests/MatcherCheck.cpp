@@ -0,0 +1,86 @@
+// Matcher: a clip of a catalog song is found at the offset it was cut from, on one thread or many, and a song
+// that is not in the catalog is not
+#include "Check.h"
+#include "Fingerprint.h"
+#include "FingerprintIndex.h"
+#include "Matcher.h"
+#include "Spectrogram.h"
+#include "Synthetic.h"
+#include <iostream>
+#include <string>
+
+#define MATCHER_CHECK_SONGS 8
+#define MATCHER_CHECK_SONG_SECONDS 30.0
+#define MATCHER_CHECK_CLIP_SECONDS 8.0
+#define MATCHER_CHECK_SNR_DB 10.0 // Noise added to the audio clip, as a microphone in a room would hear it
+
+namespace {
+
+// Samples at SYNTHETIC_SAMPLE_RATE per frame once resampled, so clips cut on a multiple of it start on a frame
+const size_t SAMPLES_PER_FRAME = size_t(HOP_SIZE) * SYNTHETIC_SAMPLE_RATE / FINGERPRINT_SAMPLE_RATE;
+
+std::vector<fingerprint> fingerprintsOf(const std::vector<float> &signal) {
+    std::vector<fingerprint> fingerprints;
+    generateFingerprints(Spectrogram(signal, SYNTHETIC_SAMPLE_RATE).view(), fingerprints);
+    return fingerprints;
+}
+
+bool isMatch(const std::vector<MatchCandidate> &candidates, uint32_t songId, int32_t offset) {
+    return !candidates.empty() && candidates[0].songId == songId && candidates[0].offset == offset;
+}
+
+} // namespace
+
+void checkMatcher() {
+    std::vector<std::vector<float>> songs;
+    std::vector<std::vector<fingerprint>> songPrints;
+    FingerprintIndexBuilder builder;
+    for (uint32_t s = 0; s < MATCHER_CHECK_SONGS; s++) {
+        songs.push_back(syntheticSong(200 + s, MATCHER_CHECK_SONG_SECONDS));
+        songPrints.push_back(fingerprintsOf(songs.back()));
+        builder.add(s, songPrints.back());
+    }
+    FingerprintIndex index = builder.build();
+    ThreadPool pool(3);
+    Matcher serial(index);
+    Matcher parallel(index, &pool);
+
+    // Exact: a song's own fingerprints over a span of frames, shifted to start at frame 0, get a vote from every
+    // hash looked up before the match is decided
+    uint32_t song = 3;
+    uint32_t first = 1000;
+    uint32_t last = 1000 + uint32_t(MATCHER_CHECK_CLIP_SECONDS * FINGERPRINT_SAMPLE_RATE / HOP_SIZE);
+    std::vector<fingerprint> query;
+    for (fingerprint f : songPrints[song]) {
+        uint32_t frame = fingerprintFrame(f);
+        if (frame >= first && frame < last) query.push_back(makeFingerprint(fingerprintHash(f), frame - first));
+    }
+    MatchParams certain;
+    certain.earlyStopMargin = 0; // Only stop when no one can catch up
+    std::vector<MatchCandidate> candidates = serial.match(query, certain);
+    if (CHECK(isMatch(candidates, song, int32_t(first)))) {
+        CHECK(candidates[0].votes == serial.hashesLookedUp());
+        CHECK(candidates.size() < 2 || candidates[1].votes < candidates[0].votes);
+    }
+    CHECK(isMatch(parallel.match(query, certain), song, int32_t(first)));
+
+    // Audio: a noisy clip of a song, cut on a frame boundary, found at that frame by default early stopping
+    for (uint32_t s : {0u, 5u, 7u}) {
+        size_t start = (s + 1) * 300 * SAMPLES_PER_FRAME;
+        size_t length = size_t(MATCHER_CHECK_CLIP_SECONDS * SYNTHETIC_SAMPLE_RATE);
+        std::vector<float> clip = noisyExcerpt(songs[s], start, length, MATCHER_CHECK_SNR_DB, s);
+        std::vector<fingerprint> prints = fingerprintsOf(clip);
+        int32_t offset = int32_t(start / SAMPLES_PER_FRAME);
+        std::vector<MatchCandidate> found = serial.match(prints);
+        if (!CHECK(isMatch(found, s, offset))) {
+            std::cerr << "  song " << s << " at frame " << offset << ": "
+                      << (found.empty() ? "no match" : "song " + std::to_string(found[0].songId) + " at frame " +
+                                                           std::to_string(found[0].offset)) << "\n";
+        }
+        CHECK(isMatch(parallel.match(prints), s, offset));
+    }
+
+    // A song that is not in the catalog gets no candidates at all
+    std::vector<float> stranger = syntheticSong(999, MATCHER_CHECK_CLIP_SECONDS);
+    CHECK(serial.match(fingerprintsOf(stranger)).empty());
+}
@@ -0,0 +1,161 @@
+// PCM decoding: every format and channel layout against a plain reference decode, the vector kernels against the
+// scalar path they must match exactly, and 16 bit files (once decoded as silence) end to end through both readers
+#include "Check.h"
+#include "CpuFeatures.h"
+#include "PcmDecode.h"
+#include "Wav.h"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+#define PCM_CHECK_FRAMES 1003 // Odd, so every vector kernel leaves a scalar tail
+#define PCM_CHECK_TOLERANCE 1e-6 // Allowed error of float output against the double reference
+
+namespace {
+
+const PcmFormat FORMATS[] = {PcmFormat::U8, PcmFormat::S16, PcmFormat::S24, PcmFormat::S32, PcmFormat::F32};
+
+// One sample decoded the obvious way, in double
+double referenceSample(PcmFormat format, const uint8_t *p) {
+    switch (format) {
+        case PcmFormat::U8: return (int(p[0]) - 128) / 128.0;
+        case PcmFormat::S16: return int16_t(uint16_t(p[0] | p[1] << 8)) / 32768.0;
+        case PcmFormat::S24: {
+            int32_t val = int32_t(p[0] | p[1] << 8 | p[2] << 16);
+            if (val & 0x800000) val -= 0x1000000;
+            return val / 8388608.0;
+        }
+        case PcmFormat::S32: {
+            uint32_t bits = uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+            return int32_t(bits) / 2147483648.0;
+        }
+        default: {
+            float val;
+            std::memcpy(&val, p, 4);
+            return val;
+        }
+    }
+}
+
+// Random sample frames; floats are kept to [-1, 1] like real float audio
+std::vector<uint8_t> randomPcm(PcmFormat format, size_t frames, size_t channels, std::mt19937 &random) {
+    std::vector<uint8_t> bytes(frames * channels * pcmBytesPerSample(format));
+    if (format == PcmFormat::F32) {
+        std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+        for (size_t i = 0; i < bytes.size(); i += 4) {
+            float val = sample(random);
+            std::memcpy(&bytes[i], &val, 4);
+        }
+    } else {
+        for (uint8_t &byte : bytes) byte = uint8_t(random());
+    }
+    return bytes;
+}
+
+void checkLayout(PcmFormat format, size_t channels, bool convertToMono, std::mt19937 &random) {
+    std::vector<uint8_t> src = randomPcm(format, PCM_CHECK_FRAMES, channels, random);
+    size_t bytesPerSample = pcmBytesPerSample(format);
+    size_t outputs = PCM_CHECK_FRAMES * (convertToMono ? 1 : channels);
+
+    std::vector<double> reference(outputs);
+    for (size_t i = 0; i < PCM_CHECK_FRAMES; i++) {
+        const uint8_t *frame = src.data() + i * channels * bytesPerSample;
+        if (convertToMono) {
+            double sum = 0.0;
+            for (size_t ch = 0; ch < channels; ch++) sum += referenceSample(format, frame + ch * bytesPerSample);
+            reference[i] = sum / channels;
+        } else {
+            for (size_t ch = 0; ch < channels; ch++) {
+                reference[i * channels + ch] = referenceSample(format, frame + ch * bytesPerSample);
+            }
+        }
+    }
+
+    std::vector<float> vectorized(outputs), scalar(outputs);
+    std::vector<double> precise(outputs);
+    decodePcm(format, src.data(), PCM_CHECK_FRAMES, channels, vectorized.data(), convertToMono);
+    SimdLevel level = simdLevel();
+    forceSimdLevel(SimdLevel::Scalar);
+    decodePcm(format, src.data(), PCM_CHECK_FRAMES, channels, scalar.data(), convertToMono);
+    forceSimdLevel(level);
+    decodePcm(format, src.data(), PCM_CHECK_FRAMES, channels, precise.data(), convertToMono);
+
+    double worstFloat = 0.0, worstDouble = 0.0;
+    bool identical = true;
+    for (size_t i = 0; i < outputs; i++) {
+        worstFloat = std::max(worstFloat, std::abs(double(vectorized[i]) - reference[i]));
+        worstDouble = std::max(worstDouble, std::abs(precise[i] - reference[i]));
+        identical = identical && vectorized[i] == scalar[i];
+    }
+    if (!CHECK(worstFloat <= PCM_CHECK_TOLERANCE) || !CHECK(worstDouble <= 1e-12) || !CHECK(identical)) {
+        std::cerr << "  format " << int(format) << ", " << channels << " channels, "
+                  << (convertToMono ? "mono" : "interleaved") << "\n";
+    }
+}
+
+// A 16 bit stereo .wav file with the given sample frames
+bool writeWav16(const std::string &path, const std::vector<int16_t> &interleaved) {
+    WavHeader h;
+    std::memcpy(h.chunkId, "RIFF", FOURCC_LENGTH);
+    std::memcpy(h.format, "WAVE", FOURCC_LENGTH);
+    std::memcpy(h.subchunk1Id, "fmt ", FOURCC_LENGTH);
+    h.subchunk1Size = 16;
+    h.audioFormat = WAVE_FORMAT_PCM;
+    h.numChannels = 2;
+    h.sampleRate = 44100;
+    h.blockAlign = 4;
+    h.byteRate = h.sampleRate * h.blockAlign;
+    h.bitsPerSample = 16;
+    std::memcpy(h.subchunk2Id, "data", FOURCC_LENGTH);
+    h.subchunk2Size = uint32_t(interleaved.size() * 2);
+    h.chunkSize = uint32_t(sizeof(WavHeader) - CHUNK_HEADER_SIZE + h.subchunk2Size);
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char *>(interleaved.data()), std::streamsize(h.subchunk2Size));
+    return bool(out);
+}
+
+void checkWav16() {
+    CHECK(pcmFormat(WAVE_FORMAT_PCM, 16) == PcmFormat::S16);
+    std::vector<int16_t> interleaved = {-32768, 0, 16384, 16384, 32767, -32767, 100, 300};
+    std::vector<float> expected = {-0.5f, 0.5f, 0.0f, 200.0f / 32768};
+
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("intune_check_" + std::to_string(::getpid()) + ".wav")).string();
+    if (!CHECK(writeWav16(path, interleaved))) return;
+
+    MappedWavFile mapped(path);
+    std::vector<float> frames(expected.size());
+    if (CHECK(mapped) && CHECK(mapped.readFrames(0, frames.size(), frames.data()) == frames.size())) {
+        CHECK(frames == expected);
+    }
+    WavFile loaded(path);
+    if (CHECK(loaded)) CHECK(loaded.extractSignal<float>() == expected);
+    std::filesystem::remove(path);
+}
+
+} // namespace
+
+void checkPcm() {
+    CHECK(pcmFormat(WAVE_FORMAT_PCM, 8) == PcmFormat::U8);
+    CHECK(pcmFormat(WAVE_FORMAT_PCM, 24) == PcmFormat::S24);
+    CHECK(pcmFormat(WAVE_FORMAT_PCM, 32) == PcmFormat::S32);
+    CHECK(pcmFormat(WAVE_FORMAT_IEEE_FLOAT, 32) == PcmFormat::F32);
+    CHECK(pcmFormat(WAVE_FORMAT_PCM, 12) == PcmFormat::Unsupported);
+    CHECK(pcmFormat(WAVE_FORMAT_IEEE_FLOAT, 64) == PcmFormat::Unsupported);
+
+    std::cerr << "  kernels: " << simdLevelName(simdLevel()) << " against scalar\n";
+    std::mt19937 random(6);
+    for (PcmFormat format : FORMATS) {
+        for (size_t channels : {1, 2, 3, 6}) {
+            checkLayout(format, channels, true, random);
+            checkLayout(format, channels, false, random);
+        }
+    }
+    checkWav16();
+}
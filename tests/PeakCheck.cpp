@@ -0,0 +1,108 @@
+// PeakExtractor's running maxima against the definition: every cell compared with its whole neighborhood
+#include "Check.h"
+#include "Peaks.h"
+#include "Spectrogram.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+#define PEAK_CHECK_BINS 257 // Bins per frame, like a 512 point FFT, so bands run past the default band starts
+
+namespace {
+
+bool samePeaks(const std::vector<Peak> &a, const std::vector<Peak> &b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Peak &x, const Peak &y) {
+        return x.frame == y.frame && x.bin == y.bin && x.mag == y.mag;
+    });
+}
+
+// The peaks as PeakExtractor defines them, found by scanning each cell's full neighborhood
+std::vector<Peak> bruteForcePeaks(const spectrogram &s, const PeakParams &params) {
+    std::vector<Peak> peaks, candidates;
+    long frames = long(s.numOfFrames()), bins = long(s.numOfBins());
+    long dt = long(params.timeRadius), df = long(params.frequencyRadius);
+    for (long t = 0; t < frames; t++) {
+        for (size_t band = 0; band < params.bandStarts.size(); band++) {
+            long begin = std::min<long>(params.bandStarts[band], bins);
+            long end = band + 1 < params.bandStarts.size() ? std::min<long>(params.bandStarts[band + 1], bins) : bins;
+            candidates.clear();
+            for (long b = begin; b < end; b++) {
+                float cell = s(t, b);
+                bool peak = cell > params.minMagnitude;
+                for (long u = std::max(0L, t - dt); peak && u <= std::min(frames - 1, t + dt); u++) {
+                    for (long c = std::max(0L, b - df); peak && c <= std::min(bins - 1, b + df); c++) {
+                        peak = s(u, c) <= cell;
+                    }
+                }
+                if (peak) candidates.push_back({uint32_t(t), uint16_t(b), cell});
+            }
+            std::stable_sort(candidates.begin(), candidates.end(), [](const Peak &a, const Peak &b) {
+                return a.mag > b.mag;
+            });
+            candidates.resize(std::min(candidates.size(), params.peaksPerBand));
+            std::sort(candidates.begin(), candidates.end(), [](const Peak &a, const Peak &b) { return a.bin < b.bin; });
+            peaks.insert(peaks.end(), candidates.begin(), candidates.end());
+        }
+    }
+    return peaks;
+}
+
+// Random cells (distinct, so which of equal peaks a band keeps never matters), with some quiet rows and columns
+spectrogram randomSpectrogram(size_t frames, std::mt19937 &random) {
+    spectrogram s(frames, PEAK_CHECK_BINS);
+    std::uniform_real_distribution<float> cell(0.0f, 1.0f);
+    for (size_t t = 0; t < frames; t++) {
+        for (size_t b = 0; b < PEAK_CHECK_BINS; b++) s(t, b) = t % 7 == 3 || b % 11 == 5 ? 0.0f : cell(random);
+    }
+    return s;
+}
+
+void checkParams(const PeakParams &params, size_t frames, std::mt19937 &random) {
+    spectrogram s = randomSpectrogram(frames, random);
+    std::vector<Peak> expected = bruteForcePeaks(s, params);
+    CHECK(!expected.empty());
+    if (!CHECK(samePeaks(extractPeaks(s.view(), params), expected))) {
+        std::cerr << "  " << frames << " frames, radius " << params.timeRadius << " x " << params.frequencyRadius
+                  << ", " << params.peaksPerBand << " per band\n";
+    }
+
+    // Streamed with peaks taken as they come, then again after a reset: the same peaks both times
+    PeakExtractor extractor(PEAK_CHECK_BINS, params);
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<Peak> streamed, taken;
+        for (size_t t = 0; t < frames; t++) {
+            extractor.push(s.row(t));
+            extractor.takePeaks(taken);
+            streamed.insert(streamed.end(), taken.begin(), taken.end());
+        }
+        extractor.flush();
+        extractor.takePeaks(taken);
+        streamed.insert(streamed.end(), taken.begin(), taken.end());
+        CHECK(samePeaks(streamed, expected));
+        extractor.reset();
+    }
+}
+
+} // namespace
+
+void checkPeaks() {
+    std::mt19937 random(8);
+    PeakParams defaults;
+    checkParams(defaults, 300, random);
+    checkParams(defaults, 5, random); // Shorter than one time block
+
+    PeakParams small;
+    small.timeRadius = 2;
+    small.frequencyRadius = 3;
+    small.minMagnitude = 0.25f;
+    small.bandStarts = {0, 7, 33, 100};
+    small.peaksPerBand = 3;
+    checkParams(small, 101, random);
+
+    PeakParams single; // Every cell above the threshold is its own neighborhood
+    single.timeRadius = 0;
+    single.frequencyRadius = 0;
+    single.bandStarts = {0};
+    single.peaksPerBand = PEAK_CHECK_BINS;
+    checkParams(single, 20, random);
+}
@@ -0,0 +1,73 @@
+// The float32 pipeline against the double reference: spectra within a relative tolerance and fingerprints
+// (what recognition actually depends on) essentially unchanged
+#include "Check.h"
+#include "Fingerprint.h"
+#include "Peaks.h"
+#include "StreamingStft.h"
+#include "Synthetic.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+
+#define PRECISION_SONG_SECONDS 20.0
+#define PRECISION_BLOCK_SIZE 4096 // Samples pushed at a time, like a decode block
+#define PRECISION_MAGNITUDE_TOLERANCE 1e-3 // Relative error allowed per cell (float measures about 7e-5)
+#define PRECISION_DYNAMIC_RANGE 1e-3 // Cells under this fraction of the loudest (-60 dB) are not compared
+#define PRECISION_MIN_AGREEMENT 0.99 // Fraction of the double path's fingerprints float must reproduce
+
+namespace {
+
+struct StftResult {
+    std::vector<float> magnitudes; // Frame after frame, FRAME_SIZE / 2 + 1 bins each
+    std::vector<fingerprint> fingerprints;
+};
+
+// Stream a signal through StreamingStft<Real> the way ingest does, keeping every frame's magnitudes
+template <typename Real>
+StftResult runStft(const std::vector<float> &signal) {
+    StftResult result;
+    PeakExtractor extractor(FRAME_SIZE / 2 + 1);
+    StreamingStft<Real> stft(SYNTHETIC_SAMPLE_RATE, [&](size_t, const std::complex<Real> *bins) {
+        for (size_t k = 0; k < FRAME_SIZE / 2 + 1; k++) result.magnitudes.push_back(float(std::abs(bins[k])));
+        extractor.push(bins);
+    });
+    for (size_t i = 0; i < signal.size(); i += PRECISION_BLOCK_SIZE) {
+        stft.push(signal.data() + i, std::min<size_t>(PRECISION_BLOCK_SIZE, signal.size() - i));
+    }
+    stft.flush();
+    extractor.flush();
+    generateFingerprints(extractor.takePeaks(), result.fingerprints);
+    return result;
+}
+
+} // namespace
+
+void checkPrecision() {
+    std::vector<float> signal = syntheticSong(7, PRECISION_SONG_SECONDS);
+    StftResult single = runStft<float>(signal);
+    StftResult reference = runStft<double>(signal);
+    if (!CHECK(single.magnitudes.size() == reference.magnitudes.size()) || !CHECK(!reference.magnitudes.empty())) {
+        return;
+    }
+
+    float loudest = *std::max_element(reference.magnitudes.begin(), reference.magnitudes.end());
+    double worst = 0.0;
+    for (size_t i = 0; i < reference.magnitudes.size(); i++) {
+        if (reference.magnitudes[i] < loudest * PRECISION_DYNAMIC_RANGE) continue;
+        double error = std::abs(double(single.magnitudes[i]) - reference.magnitudes[i]) / reference.magnitudes[i];
+        worst = std::max(worst, error);
+    }
+    std::cerr << "  largest relative magnitude error: " << worst << "\n";
+    CHECK(worst <= PRECISION_MAGNITUDE_TOLERANCE);
+
+    std::vector<fingerprint> scratch;
+    sortFingerprints(single.fingerprints, scratch);
+    sortFingerprints(reference.fingerprints, scratch);
+    std::vector<fingerprint> common;
+    std::set_intersection(reference.fingerprints.begin(), reference.fingerprints.end(),
+                          single.fingerprints.begin(), single.fingerprints.end(), std::back_inserter(common));
+    double agreement = reference.fingerprints.empty() ? 0.0 : double(common.size()) / reference.fingerprints.size();
+    std::cerr << "  fingerprints: " << reference.fingerprints.size() << ", float agreement: " << agreement << "\n";
+    CHECK(agreement >= PRECISION_MIN_AGREEMENT);
+}
@@ -0,0 +1,62 @@
+#include "Check.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+struct NamedCheck {
+    const char *name;
+    void (*run)();
+};
+
+const NamedCheck CHECKS[] = {
+    {"precision", checkPrecision},
+    {"allocations", checkAllocations},
+    {"pcm", checkPcm},
+    {"peaks", checkPeaks},
+    {"index", checkIndex},
+    {"matcher", checkMatcher},
+    {"hash", checkHash},
+};
+
+size_t failures = 0;
+
+} // namespace
+
+bool checkThat(bool ok, const char *expression, const char *file, int line) {
+    if (!ok) {
+        std::cerr << file << ":" << line << ": check failed: " << expression << "\n";
+        failures++;
+    }
+    return ok;
+}
+
+size_t checkFailures() {
+    return failures;
+}
+
+/**
+ * intune_check: correctness checks that benchmarks only measure (precision, allocations, ...). Runs the check
+ * named by the argument, or every check without one, and exits non-zero if any failed. Each check is also a
+ * ctest test.
+ */
+int main(int argc, char **argv) {
+    bool ran = false;
+    for (const NamedCheck &check : CHECKS) {
+        if (argc >= 2 && std::strcmp(argv[1], check.name) != 0) continue;
+        std::cerr << "Checking " << check.name << "\n";
+        check.run();
+        ran = true;
+    }
+    if (!ran) {
+        std::cout << "Usage: " << argv[0] << " [";
+        for (size_t i = 0; i < sizeof(CHECKS) / sizeof(CHECKS[0]); i++) std::cout << (i ? " | " : "") << CHECKS[i].name;
+        std::cout << "]\n";
+        return 1;
+    }
+    if (checkFailures()) {
+        std::cerr << checkFailures() << " check(s) failed\n";
+        return 1;
+    }
+    return 0;
+}